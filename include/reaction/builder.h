@@ -0,0 +1,82 @@
+#pragma once
+
+#include "reaction/react.h"
+
+namespace reaction {
+// 批量建图事务: 建图期间只分配结点和加边, 不做逐边的环检测和逐结点的首次求值;
+// commit()时对新结点做一次拓扑排序校验无环, 再按拓扑序统一求值一遍.
+// 未提交就析构(或提交失败)时撤销本事务创建的所有计算结点
+class GraphBuilder {
+public:
+    explicit GraphBuilder(size_t expectedNodes = 0) {
+        ObserverGraph::getInstance().reserve(expectedNodes);
+        m_pending.reserve(expectedNodes);
+    }
+
+    ~GraphBuilder() {
+        if (!m_pending.empty()) {
+            rollback();
+        }
+    }
+
+    GraphBuilder(const GraphBuilder &) = delete;
+    GraphBuilder &operator=(const GraphBuilder &) = delete;
+
+    template <typename SrcType>
+    auto var(SrcType &&t) {
+        return reaction::var(std::forward<SrcType>(t)); // 源结点无需校验和求值
+    }
+
+    template <typename SrcType>
+    auto constVar(SrcType &&t) {
+        return reaction::constVar(std::forward<SrcType>(t));
+    }
+
+    // 依赖必须显式给出; 自动追踪依赖的calc要等求值才知道依赖, 请在commit之后用reaction::calc创建
+    template <typename Func, typename... Args>
+        requires HasArguments<Args...>
+    auto calc(Func &&fun, Args &&...args) {
+        auto ptr = std::make_shared<ReactImpl<std::decay_t<Func>, std::decay_t<Args>...>>();
+        ObserverGraph::getInstance().addNode(ptr);
+        m_pending.push_back(ptr);
+        ptr->setSourceDeferred(std::forward<Func>(fun), std::forward<Args>(args)...);
+        return React(ptr);
+    }
+
+    template <typename Func, typename... Args>
+        requires HasArguments<Args...>
+    auto action(Func &&fun, Args &&...args) {
+        return calc(std::forward<Func>(fun), std::forward<Args>(args)...);
+    }
+
+    void commit() {
+        std::vector<ObserverNode *> order;
+        REACTION_TRY {
+            order = ObserverGraph::getInstance().validateNodes(m_pending);
+            for (auto node : order) {
+                node->evaluate();
+            }
+        } REACTION_CATCH_ALL {
+            rollback();
+            REACTION_RETHROW;
+        }
+        m_pending.clear();
+    }
+
+    size_t pending() const {
+        return m_pending.size();
+    }
+
+private:
+    void rollback() {
+        auto &graph = ObserverGraph::getInstance();
+        for (const auto &node : m_pending) {
+            graph.unlinkNode(node);
+            graph.removeNode(node.get());
+        }
+        m_pending.clear();
+    }
+
+    std::vector<NodePtr> m_pending;
+};
+} // namespace reaction
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <span>
+
+namespace reaction {
+inline uint64_t nextLaneStamp() { // 所有Lanes<T>共享同一个递增序号
+    static std::atomic<uint64_t> stampCounter{0};
+    return stampCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// N个同类值连续存放在一个结点中(结构数组). 脏位图记录最近一轮传播改动了哪些lane;
+// 另外每个lane记录最后一次改动时的更新序号, 下游据此找出自己上次读取之后的所有改动, 不受轮次限制
+template <typename T>
+class Lanes {
+public:
+    using value_type = T;
+    static constexpr size_t WordBits = 64;
+
+    Lanes() = default;
+
+    explicit Lanes(size_t n, const T &init = T{}) : m_values(n, init), m_dirty(wordCount(n), 0), m_laneStamps(n), m_wordStamps(wordCount(n)) {
+        m_origin = m_stamp = nextLaneStamp();
+        markAllDirty(); // 新建或整体替换时所有lane都算改动
+    }
+
+    // 拷贝出来的是一份独立的值, 取新的来源序号: 整体写回结点时下游会全部重新计算
+    Lanes(const Lanes &other)
+        : m_values(other.m_values), m_dirty(other.m_dirty), m_laneStamps(other.m_laneStamps), m_wordStamps(other.m_wordStamps),
+          m_stamp(other.m_stamp), m_origin(nextLaneStamp()) {}
+
+    Lanes &operator=(const Lanes &other) {
+        if (this != &other) {
+            *this = Lanes(other);
+        }
+        return *this;
+    }
+
+    Lanes(Lanes &&) = default;
+    Lanes &operator=(Lanes &&) = default;
+
+    size_t size() const {
+        return m_values.size();
+    }
+
+    const T &operator[](size_t i) const {
+        return m_values[i];
+    }
+
+    std::span<const T> values() const {
+        return m_values;
+    }
+
+    std::span<T> values() {
+        return m_values;
+    }
+
+    void set(size_t i, const T &value) {
+        m_values[i] = value;
+        m_dirty[i / WordBits] |= uint64_t{1} << (i % WordBits);
+        m_laneStamps[i] = m_stamp;
+        m_wordStamps[i / WordBits] = m_stamp;
+    }
+
+    // 第w个字中mask对应的lane已被直接写入values(), 标记为本次更新的改动
+    void markWord(size_t w, uint64_t mask) {
+        m_dirty[w] |= mask;
+        m_wordStamps[w] = m_stamp;
+        size_t base = w * WordBits;
+        if (mask == ~uint64_t{0}) {
+            std::fill_n(m_laneStamps.begin() + base, WordBits, m_stamp);
+            return;
+        }
+        for (; mask; mask &= mask - 1) {
+            m_laneStamps[base + std::countr_zero(mask)] = m_stamp;
+        }
+    }
+
+    // 第w个字中在序号stamp之后被改动过的lane
+    uint64_t changedSince(size_t w, uint64_t stamp) const {
+        if (m_wordStamps[w] <= stamp) {
+            return 0;
+        }
+        size_t base = w * WordBits;
+        size_t count = std::min(WordBits, size() - base);
+        uint64_t mask = 0;
+        for (size_t j = 0; j < count; ++j) {
+            mask |= uint64_t{m_laneStamps[base + j] > stamp} << j;
+        }
+        return mask;
+    }
+
+    bool isDirty(size_t i) const {
+        return m_dirty[i / WordBits] >> (i % WordBits) & 1;
+    }
+
+    size_t dirtyCount() const {
+        size_t count = 0;
+        for (auto word : m_dirty) {
+            count += std::popcount(word);
+        }
+        return count;
+    }
+
+    std::span<const uint64_t> dirtyWords() const {
+        return m_dirty;
+    }
+
+    template <typename F>
+    void forEachDirty(F &&fun) const {
+        for (size_t w = 0; w < m_dirty.size(); ++w) {
+            for (uint64_t word = m_dirty[w]; word; word &= word - 1) {
+                std::invoke(fun, w * WordBits + std::countr_zero(word));
+            }
+        }
+    }
+
+    void clearDirty() {
+        std::ranges::fill(m_dirty, 0);
+    }
+
+    // 开始一次批量更新并取新的更新序号; 同一轮传播中的多次更新累积脏位, 新一轮开始时才清空.
+    // 下游不依赖脏位而是比较lane序号, 所以错过某一轮的下游(如Idle结点)之后仍能看到所有改动
+    void beginUpdate() {
+        if (m_pass != PassGuard::current()) {
+            clearDirty();
+            m_pass = PassGuard::current();
+        }
+        m_stamp = nextLaneStamp();
+    }
+
+    // 最近一次更新的序号
+    uint64_t stamp() const {
+        return m_stamp;
+    }
+
+    // 来源序号: 构造, 拷贝或resize时更换; 与上次读取时不同说明整个值被替换过
+    uint64_t origin() const {
+        return m_origin;
+    }
+
+    void markAllDirty() {
+        std::ranges::fill(m_dirty, ~uint64_t{0});
+        if (auto tail = size() % WordBits; tail != 0) {
+            m_dirty.back() = (uint64_t{1} << tail) - 1;
+        }
+        std::ranges::fill(m_laneStamps, m_stamp);
+        std::ranges::fill(m_wordStamps, m_stamp);
+    }
+
+    void resize(size_t n) {
+        m_values.resize(n);
+        m_dirty.resize(wordCount(n));
+        m_laneStamps.resize(n);
+        m_wordStamps.resize(wordCount(n));
+        m_origin = m_stamp = nextLaneStamp();
+        markAllDirty();
+    }
+
+private:
+    static size_t wordCount(size_t n) {
+        return (n + WordBits - 1) / WordBits;
+    }
+
+    std::vector<T> m_values;
+    std::vector<uint64_t> m_dirty;
+    std::vector<uint64_t> m_laneStamps; // 每个lane最后一次改动的序号
+    std::vector<uint64_t> m_wordStamps; // 每个字中最大的lane序号, 用于整字跳过
+    uint64_t m_stamp = 0;
+    uint64_t m_origin = 0;
+    uint64_t m_pass = 0; // 脏位所属的传播轮次
+};
+
+template <typename T>
+using BulkVar = React<ReactImpl<Lanes<T>>>;
+
+template <typename T>
+auto bulkVar(size_t n, const T &init = T{}) {
+    return var(Lanes<T>(n, init));
+}
+
+// 一次批量更新只触发一次传播; fun中调用Lanes::set写入的lane被标记为脏, 在batch中多次更新时脏位累积
+template <typename T, typename F>
+void bulkUpdate(BulkVar<T> &src, F &&fun) {
+    src.update([&](Lanes<T> &lanes) {
+        lanes.beginUpdate();
+        std::invoke(fun, lanes);
+    });
+}
+
+// bulkCalc的逐lane计算: 记录每个上游上次参与计算时的来源和更新序号,
+// 重新计算所有在那之后改动过的lane的并集; 来源变化(整体替换)的上游所有lane都算改动
+template <typename Fun, typename Out, size_t N>
+struct BulkKernel {
+    static constexpr size_t WordBits = Out::WordBits;
+
+    Fun fun;
+    mutable std::array<uint64_t, N> seen{};
+    mutable std::array<uint64_t, N> origin{};
+
+    template <typename... L>
+    void operator()(Out &out, const L &...lanes) const {
+        std::array<uint64_t, N> since = seen;
+        std::array<bool, N> replaced{};
+        size_t k = 0;
+        ((replaced[k] = lanes.origin() != origin[k], origin[k] = lanes.origin(), seen[k] = lanes.stamp(), ++k), ...);
+        out.beginUpdate(); // 本结点作为上游时同样按序号提供改动
+
+        size_t n = std::min({lanes.size()...});
+        if (out.size() != n) {
+            out.resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                out.values()[i] = std::invoke(fun, lanes[i]...);
+            }
+            return;
+        }
+
+        auto result = out.values();
+        size_t words = (n + WordBits - 1) / WordBits;
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t word = 0;
+            k = 0;
+            ((word |= replaced[k] ? ~uint64_t{0} : lanes.changedSince(w, since[k]), ++k), ...);
+            size_t base = w * WordBits;
+            if (n - base < WordBits) {
+                word &= (uint64_t{1} << (n - base)) - 1; // 上游长度不一时截掉越界的lane
+            }
+            if (!word) {
+                continue;
+            }
+            out.markWord(w, word);
+            if (word == ~uint64_t{0}) {
+                for (size_t i = base; i < base + WordBits; ++i) {
+                    result[i] = std::invoke(fun, lanes.values()[i]...);
+                }
+                continue;
+            }
+            for (; word; word &= word - 1) {
+                size_t i = base + std::countr_zero(word);
+                result[i] = std::invoke(fun, lanes.values()[i]...);
+            }
+        }
+    }
+};
+
+// 逐lane的计算结点: fun作用于单个lane的值, 只重新计算上游脏lane的并集;
+// 整字(64个lane)全脏时走连续循环, 便于编译器自动向量化
+template <typename Fun, typename... Args>
+    requires HasArguments<Args...>
+auto bulkCalc(Fun &&fun, Args &&...args) {
+    using ResultType = std::invoke_result_t<Fun &, const typename std::decay_t<Args>::ValueType::value_type &...>;
+    using Out = Lanes<ResultType>;
+    using Kernel = BulkKernel<std::decay_t<Fun>, Out, sizeof...(Args)>;
+    return calc(inPlace<Out>(Kernel{std::forward<Fun>(fun)}), std::forward<Args>(args)...);
+}
+} // namespace reaction
@@ -25,6 +25,9 @@ struct ValueWrapper;
 
 template <typename Op, typename L, typename R>
 class BinaryOpExpr;
+
+template <typename Type, typename Fun>
+struct InPlace;
 // ------------------------------------------concepts----------------------------------------------
 template <typename T, typename U>
 concept Convertable = std::is_convertible_v<std::decay_t<T>, std::decay_t<U>>;
@@ -87,10 +90,15 @@ struct ExpressionTraits<React<ReactImpl<T>>> {
 
 template <typename Fun, typename... Args>
 struct ExpressionTraits<React<ReactImpl<Fun, Args...>>> {
-    using rawType = std::invoke_result_t<Fun, typename ExpressionTraits<Args>::type...>; // 为了避免歧义，递归萃取Args中的类型
+    using rawType = std::invoke_result_t<Fun, const typename ExpressionTraits<Args>::type &...>; // 为了避免歧义，递归萃取Args中的类型; 上游值以const引用传入
     using type = std::conditional_t<VoidType<rawType>, VoidWrapper, rawType>;            // 如果是void类型，使用VoidWrapper
 };
 
+template <typename Type, typename Fun, typename... Args>
+struct ExpressionTraits<React<ReactImpl<InPlace<Type, Fun>, Args...>>> {
+    using type = Type; // 原地计算的结果类型由用户显式给出
+};
+
 template <typename Fun, typename... Args>
 using ReturnType = typename ExpressionTraits<React<ReactImpl<Fun, Args...>>>::type;
 
@@ -102,6 +110,17 @@ template <typename Op, typename L, typename R>
 struct BinaryOpExprTraits<BinaryOpExpr<Op, L, R>> : std::true_type {
 };
 
+template <typename T>
+struct InPlaceTraits : std::false_type {
+};
+
+template <typename Type, typename Fun>
+struct InPlaceTraits<InPlace<Type, Fun>> : std::true_type {
+};
+
+template <typename T>
+concept IsInPlace = InPlaceTraits<std::decay_t<T>>::value;
+
 template <typename T>
 concept IsBinaryOpExpr = BinaryOpExprTraits<std::decay_t<T>>::value;
 
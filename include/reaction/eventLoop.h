@@ -0,0 +1,171 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <array>
+#include <cerrno>
+#include <optional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace reaction {
+// 定长二进制消息的解码器: 每次从fd读取一个T, 没有完整数据时返回nullopt.
+// 适用于非阻塞的pipe/eventfd/UNIX socket, 写端每次写入整条消息
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+auto rawDecoder() {
+    return [](int fd) -> std::optional<T> {
+        T value;
+        if (::read(fd, &value, sizeof(T)) != static_cast<ssize_t>(sizeof(T))) {
+            return std::nullopt;
+        }
+        return value;
+    };
+}
+
+// 基于epoll的输入适配层: 把文件描述符绑定到var结点, 由用户的解码器把就绪的数据转成值.
+// 每次唤醒时所有就绪的输入合并成一轮传播, 下游每个结点只求值一次.
+// 事件循环和图在同一个线程上运行, 只有stop()可以从其他线程调用
+class EventLoop {
+public:
+    static constexpr size_t MaxBurst = 64; // 每个fd每次唤醒最多解码的消息数, 避免单个输入饿死其他输入
+
+    EventLoop() {
+        m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_epoll < 0 || m_wakeup < 0) {
+            closeAll();
+            REACTION_THROW(std::runtime_error("Failed to create event loop."));
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = m_wakeup;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &event);
+    }
+
+    ~EventLoop() {
+        closeAll();
+    }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // 绑定fd到源结点: fd可读时反复调用decoder(fd), 直到它返回nullopt. fd的所有权仍归调用者.
+    // 普通文件不能被epoll监视(epoll_ctl返回EPERM), 此时bind抛异常, 应改为直接读取后写入var
+    template <typename ReactType, typename Decoder>
+    void bind(int fd, const React<ReactType> &src, Decoder &&decoder) {
+        using Type = std::decay_t<typename ReactType::ValueType>;
+        static_assert(std::convertible_to<std::invoke_result_t<std::decay_t<Decoder> &, int>, std::optional<Type>>,
+            "Decoder must be callable as std::optional<T>(int fd).");
+        if (m_bindings.contains(fd)) {
+            REACTION_THROW(std::runtime_error("File descriptor is already bound."));
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            REACTION_THROW(std::runtime_error("Failed to watch file descriptor."));
+        }
+        m_bindings[fd] = [ptr = src.getPtr(), decoder = std::forward<Decoder>(decoder)](int fd) mutable {
+            Burst burst;
+            while (burst.count < MaxBurst) {
+                std::optional<Type> value = std::invoke(decoder, fd);
+                if (!value) {
+                    burst.drained = true;
+                    break;
+                }
+                ptr->value(std::move(*value));
+                ++burst.count;
+            }
+            return burst;
+        };
+    }
+
+    void unbind(int fd) {
+        if (m_bindings.erase(fd)) {
+            ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+
+    size_t size() const {
+        return m_bindings.size();
+    }
+
+    // 等待一次(timeoutMs < 0表示一直等), 把本次就绪的所有输入合并为一轮传播; 返回解码出的消息数.
+    // 对端关闭或出错的fd在解码器返回nullopt(读完剩余数据)后自动解绑; 因MaxBurst截断时留到下一次继续读
+    size_t runOnce(int timeoutMs = -1) {
+        int ready = ::epoll_wait(m_epoll, m_events.data(), static_cast<int>(m_events.size()), timeoutMs);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                return 0;
+            }
+            REACTION_THROW(std::runtime_error("epoll_wait failed."));
+        }
+        size_t applied = 0;
+        PassGuard pass;
+        for (int i = 0; i < ready; ++i) {
+            int fd = m_events[i].data.fd;
+            if (fd == m_wakeup) {
+                uint64_t drained;
+                [[maybe_unused]] auto n = ::read(m_wakeup, &drained, sizeof(drained));
+                continue;
+            }
+            auto it = m_bindings.find(fd);
+            if (it == m_bindings.end()) {
+                continue;
+            }
+            auto burst = it->second(fd);
+            applied += burst.count;
+            if (burst.drained && (m_events[i].events & (EPOLLHUP | EPOLLERR))) {
+                m_closed.push_back(fd);
+            }
+        }
+        pass.finish();
+        for (int fd : m_closed) {
+            unbind(fd);
+        }
+        m_closed.clear();
+        return applied;
+    }
+
+    // 循环处理输入直到stop(); 没有输入时求值积压的Idle结点
+    void run() {
+        while (!m_stop.load()) {
+            if (runOnce(Scheduler::getInstance().hasIdleWork() ? 0 : -1) == 0) {
+                runIdle();
+            }
+        }
+        m_stop.store(false); // 之后可以再次run()
+    }
+
+    // 线程安全: 唤醒阻塞中的run()并让它返回; 在run()之前调用时下一次run()立即返回
+    void stop() {
+        m_stop.store(true);
+        uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(m_wakeup, &one, sizeof(one));
+    }
+
+private:
+    // 一次唤醒中对单个fd的解码结果
+    struct Burst {
+        size_t count = 0;
+        bool drained = false; // 解码器返回了nullopt, 而不是被MaxBurst截断
+    };
+
+    void closeAll() {
+        if (m_wakeup >= 0) {
+            ::close(m_wakeup);
+        }
+        if (m_epoll >= 0) {
+            ::close(m_epoll);
+        }
+    }
+
+    int m_epoll = -1;
+    int m_wakeup = -1; // stop()用来唤醒epoll_wait的eventfd
+    std::atomic<bool> m_stop{false};
+    std::unordered_map<int, std::function<Burst(int)>> m_bindings;
+    std::array<epoll_event, 64> m_events{};
+    std::vector<int> m_closed;
+};
+} // namespace reaction
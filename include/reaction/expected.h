@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// 核心头文件可以在-fno-exceptions下编译: 此时throw改为打印信息后abort, try/catch退化为直线代码
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define REACTION_EXCEPTIONS 1
+#define REACTION_THROW(ex) throw ex
+#define REACTION_TRY try
+#define REACTION_CATCH_ALL catch (...)
+#define REACTION_RETHROW throw
+#else
+#define REACTION_EXCEPTIONS 0
+#define REACTION_THROW(ex) ::reaction::fatalError(ex)
+#define REACTION_TRY if (true)
+#define REACTION_CATCH_ALL else
+#define REACTION_RETHROW std::abort()
+#endif
+
+namespace reaction {
+template <typename Ex>
+[[noreturn]] void fatalError(const Ex &ex) {
+    std::fputs(ex.what(), stderr);
+    std::fputc('\n', stderr);
+    std::abort();
+}
+
+// 作为值在图中传播的错误
+struct Error {
+    std::string message;
+
+    bool operator==(const Error &) const = default;
+};
+
+// 简化版std::expected: 要么是值, 要么是错误
+template <typename T>
+class Expected {
+public:
+    using ValueType = T;
+
+    Expected() : m_storage(std::in_place_index<0>) {}
+    Expected(const T &value) : m_storage(std::in_place_index<0>, value) {}
+    Expected(T &&value) : m_storage(std::in_place_index<0>, std::move(value)) {}
+    Expected(Error error) : m_storage(std::in_place_index<1>, std::move(error)) {}
+
+    bool hasValue() const {
+        return m_storage.index() == 0;
+    }
+
+    explicit operator bool() const {
+        return hasValue();
+    }
+
+    const T &value() const {
+        if (!hasValue()) {
+            REACTION_THROW(std::runtime_error(error().message));
+        }
+        return *std::get_if<0>(&m_storage);
+    }
+
+    const Error &error() const {
+        return *std::get_if<1>(&m_storage);
+    }
+
+    template <typename U>
+    T valueOr(U &&fallback) const {
+        return hasValue() ? *std::get_if<0>(&m_storage) : static_cast<T>(std::forward<U>(fallback));
+    }
+
+    bool operator==(const Expected &) const = default;
+
+private:
+    std::variant<T, Error> m_storage;
+};
+
+template <typename T>
+struct IsExpectedType : std::false_type {
+    using type = T;
+};
+
+template <typename T>
+struct IsExpectedType<Expected<T>> : std::true_type {
+    using type = T;
+};
+
+template <typename T>
+concept IsExpected = IsExpectedType<std::decay_t<T>>::value;
+
+template <typename T>
+using UnwrapExpected = typename IsExpectedType<std::decay_t<T>>::type;
+} // namespace reaction
@@ -1,9 +1,28 @@
 #pragma once
 
 #include "reaction/resource.h"
+#include <algorithm>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 namespace reaction {
+inline thread_local std::function<void(NodePtr)> g_reg_fun = nullptr; // 全局注册函数，用于注册回调
+
+struct RegGuard {
+public:
+    RegGuard(const std::function<void(NodePtr)> &reg_fun) : m_prev(std::move(g_reg_fun)) {
+        g_reg_fun = reg_fun; // 设置全局注册函数
+    }
+
+    ~RegGuard() {
+        g_reg_fun = std::move(m_prev); // 恢复外层的注册函数, 支持嵌套求值
+    }
+
+private:
+    std::function<void(NodePtr)> m_prev;
+};
+
 template <typename Op, typename L, typename R>
 class BinaryOpExpr {
 public:
@@ -93,6 +112,19 @@ auto operator/(L &&lhs, R &&rhs) {
     return makeBinaryOpExpr<divOp>(std::forward<L>(lhs), std::forward<R>(rhs));
 }
 
+// 原地计算: 函数对象形如void(Type &out, const Args &...), 结果直接写入结点已有的值, 复用其容量.
+// 也可以返回bool: 返回false表示本次没有变化, 不通知下游, 整个下游子图在本轮中被跳过
+template <typename Type, typename Fun>
+struct InPlace {
+    using ValueType = Type;
+    Fun fun;
+};
+
+template <typename Type, typename Fun>
+auto inPlace(Fun &&fun) {
+    return InPlace<Type, std::decay_t<Fun>>{std::forward<Fun>(fun)};
+}
+
 // 主模板声明（带参数包）
 template <typename... Ts>
 class Expression;
@@ -106,25 +138,95 @@ public:
 
     template <typename F, typename... A>
     void setSource(F &&fun, A &&...args) {
-        if constexpr (std::convertible_to<ReturnType<std::decay_t<F>, std::decay_t<A>...>, ValueType>) {
-            this->updateObserver(args.getPtr()...);
+        if constexpr (std::convertible_to<ReturnType<std::decay_t<F>, std::decay_t<A>...>, ValueType> && IsInPlace<F> == IsInPlace<Fun>) {
+            // 失败时完整回滚: 函数, 追踪模式和依赖边都恢复到调用前
+            bool oldAutoTrack = std::exchange(m_autoTrack, sizeof...(A) == 0);
+            std::vector<NodePtr> oldDeps(this->dependencies().begin(), this->dependencies().end());
+            std::ranges::sort(oldDeps);
+            if (!m_autoTrack) { // 显式参数: 依赖固定, 只在set/reset时做一次差分
+                m_tracked.clear();
+                (m_tracked.push_back(args.getPtr()), ...);
+                REACTION_TRY {
+                    commitDependency(); // 失败时边已由updateDependency回滚
+                } REACTION_CATCH_ALL {
+                    m_autoTrack = oldAutoTrack;
+                    REACTION_RETHROW;
+                }
+            }
+            auto oldFun = std::move(m_fun);
+            auto oldFunBytes = m_funBytes;
             setFunctor(createFun(std::forward<F>(fun), std::forward<A>(args)...));
-            evaluate();
+            REACTION_TRY {
+                evaluate();
+            } REACTION_CATCH_ALL {
+                m_fun = std::move(oldFun);
+                m_funBytes = oldFunBytes;
+                m_autoTrack = oldAutoTrack;
+                ObserverGraph::getInstance().updateDependency(this->shared_from_this(), oldDeps); // 旧依赖原本无环, 恢复不会失败
+                REACTION_RETHROW;
+            }
         }
     }
 
+    // 批量建图用: 只设置函数和依赖边, 环检测与首次求值推迟到GraphBuilder::commit
+    template <typename F, HasArguments... A>
+    void setSourceDeferred(F &&fun, A &&...args) {
+        static_assert(std::convertible_to<ReturnType<std::decay_t<F>, std::decay_t<A>...>, ValueType> && IsInPlace<F> == IsInPlace<Fun>);
+        m_autoTrack = false;
+        auto self = this->shared_from_this();
+        (ObserverGraph::getInstance().addObserverUnchecked(self, args.getPtr()), ...);
+        setFunctor(createFun(std::forward<F>(fun), std::forward<A>(args)...));
+    }
+
     void addObjCb(NodePtr obj) {
-        this->updateObserver(obj);
+        m_tracked.push_back(std::move(obj));
+    }
+
+    // std::function为函数对象单独分配的堆内存, 0表示存放在内部缓冲区
+    size_t functorHeapBytes() const {
+        return m_funBytes;
+    }
+
+    void evaluate() override {
+        recompute();
     }
 
 private:
     void valueChanged() override {
-        evaluate();
-        this->notify();
+        if (recompute()) {
+            this->notify();
+        }
+    }
+
+    // 返回值是否需要向下游传播
+    bool recompute() {
+        if (!m_autoTrack) {
+            return invoke();
+        }
+        // 自动追踪: 每次求值都重新收集依赖, 与上一次的依赖集合做差分
+        m_tracked.clear();
+        RegGuard guard([this](NodePtr obj) {
+            this->addObjCb(std::move(obj));
+        });
+        return invoke();
+    }
+
+    template <typename F, typename... A>
+        requires IsInPlace<F>
+    auto createFun(F &&fun, A &&...args) {
+        return [fun = std::forward<F>(fun).fun, ... args = args.getPtr()](ValueType &out) {
+            if constexpr (std::same_as<decltype(std::invoke(fun, out, std::as_const(args->get())...)), bool>) {
+                return std::invoke(fun, out, std::as_const(args->get())...);
+            } else {
+                std::invoke(fun, out, std::as_const(args->get())...);
+                return true;
+            }
+        };
     }
 
     template <typename F, typename... A>
     auto createFun(F &&fun, A &&...args) {
+        // 上游值一律以const引用传入, 形参写成const T&/std::string_view/std::span<const T>即可零拷贝读取
         return [fun = std::forward<F>(fun), ... args = args.getPtr()]() {
             if constexpr (VoidType<ValueType>) {
                 std::invoke(fun, args->get()...);
@@ -135,19 +237,53 @@ private:
         };
     }
 
-    void evaluate() {
-        if constexpr (VoidType<ValueType>) {
+    bool invoke() {
+        if constexpr (IsInPlace<Fun>) {
+            if (!this->hasValue()) {
+                this->updateValue(ValueType{});
+            }
+            bool changed = std::invoke(m_fun, this->getValue());
+            if (m_autoTrack) commitDependency();
+            return changed;
+        } else if constexpr (VoidType<ValueType>) {
             std::invoke(m_fun);
+            if (m_autoTrack) commitDependency();
         } else {
-            this->updateValue(std::invoke(m_fun));
+            auto result = std::invoke(m_fun);
+            if (m_autoTrack) commitDependency(); // 先更新依赖, 出现环时不会写入新值
+            this->updateValue(std::move(result));
         }
+        return true;
     }
 
-    void setFunctor(const std::function<ValueType()> &fun) {
-        m_fun = fun;
+    void commitDependency() {
+        std::ranges::sort(m_tracked);
+        auto [first, last] = std::ranges::unique(m_tracked);
+        m_tracked.erase(first, last);
+        REACTION_TRY {
+            ObserverGraph::getInstance().updateDependency(this->shared_from_this(), m_tracked);
+        } REACTION_CATCH_ALL {
+            m_tracked.clear();
+            REACTION_RETHROW;
+        }
+        m_tracked.clear(); // 只保留容量, 不持有引用, 否则失败的自引用会形成shared_ptr环
+    }
+
+    using FunType = std::conditional_t<IsInPlace<Fun>, std::function<bool(ValueType &)>, std::function<ValueType()>>;
+
+    template <typename F>
+    void setFunctor(F &&fun) {
+        using Stored = std::decay_t<F>;
+        // libstdc++只把不超过两个指针大小且可平凡复制的函数对象存放在内部缓冲区
+        constexpr bool local = sizeof(Stored) <= 2 * sizeof(void *) && alignof(Stored) <= alignof(void *) && std::is_trivially_copyable_v<Stored>;
+        m_funBytes = local ? 0 : sizeof(Stored);
+        m_fun = std::forward<F>(fun);
     }
 
-    std::function<ValueType()> m_fun;
+    bool m_autoTrack = false;
+    std::vector<NodePtr> m_tracked; // 复用的依赖收集缓冲区
+    FunType m_fun;
+    size_t m_funBytes = 0;
 };
 
 // 特化1：简单表达式（单一参数）
@@ -159,6 +295,40 @@ public:
     using ExprType = VarExpr;
     using Resource<Type>::Resource;
     using ValueType = Type;
+    using WriteHook = std::function<void(const std::remove_const_t<Type> &)>;
+
+    // 写入钩子: 每次value()/update()写入后, 在通知下游之前按写入顺序调用.
+    // 与下游结点不同, 同一轮传播中的多次写入会逐次触发, 用于日志等需要看到每一次输入的场景
+    uint64_t addWriteHook(WriteHook hook) {
+        if (!m_hooks) {
+            m_hooks = std::make_unique<WriteHooks>();
+        }
+        m_hooks->hooks.emplace_back(++m_hooks->next, std::move(hook));
+        return m_hooks->next;
+    }
+
+    void removeWriteHook(uint64_t id) {
+        if (m_hooks) {
+            std::erase_if(m_hooks->hooks, [id](const auto &entry) { return entry.first == id; });
+        }
+    }
+
+protected:
+    void runWriteHooks() {
+        if (m_hooks) { // 没有钩子时只多一次判空
+            for (const auto &[id, hook] : m_hooks->hooks) {
+                hook(this->getValue());
+            }
+        }
+    }
+
+private:
+    struct WriteHooks {
+        uint64_t next = 0;
+        std::vector<std::pair<uint64_t, WriteHook>> hooks;
+    };
+
+    std::unique_ptr<WriteHooks> m_hooks;
 };
 
 template <typename Op, typename L, typename R>
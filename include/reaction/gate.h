@@ -0,0 +1,56 @@
+#pragma once
+
+#include "reaction/react.h"
+
+namespace reaction {
+// 门控结点: 基于返回bool的原地计算, 不满足条件时不通知下游, 下游子图在本轮中完全不被调度.
+// 在第一次放行之前结点的值为ValueType{}
+template <typename Src>
+using GateValue = std::decay_t<typename std::decay_t<Src>::ValueType>;
+
+// 只在pred(v)成立时转发src的新值
+template <typename Pred, typename Src>
+auto filter(Pred &&pred, Src &&src) {
+    using Type = GateValue<Src>;
+    static_assert(std::default_initializable<Type>, "filter requires a default constructible value type.");
+    return calc(inPlace<Type>([pred = std::forward<Pred>(pred)](Type &out, const Type &value) {
+        if (!std::invoke(pred, value)) {
+            return false;
+        }
+        out = value;
+        return true;
+    }),
+        std::forward<Src>(src));
+}
+
+// flag为真时转发src; flag变为真时立即转发src的当前值, 为假时整个下游休眠
+template <typename Flag, typename Src>
+auto when(Flag &&flag, Src &&src) {
+    using Type = GateValue<Src>;
+    static_assert(std::default_initializable<Type>, "when requires a default constructible value type.");
+    static_assert(std::convertible_to<GateValue<Flag>, bool>, "when requires a boolean flag.");
+    return calc(inPlace<Type>([](Type &out, const GateValue<Flag> &open, const Type &value) {
+        if (!static_cast<bool>(open)) {
+            return false;
+        }
+        out = value;
+        return true;
+    }),
+        std::forward<Flag>(flag), std::forward<Src>(src));
+}
+
+// 只在值与上次转发的值不同时转发
+template <typename Src>
+auto distinctUntilChanged(Src &&src) {
+    using Type = GateValue<Src>;
+    static_assert(std::equality_comparable<Type>, "distinctUntilChanged requires operator==.");
+    return calc(inPlace<Type>([](Type &out, const Type &value) {
+        if (out == value) {
+            return false;
+        }
+        out = value;
+        return true;
+    }),
+        std::forward<Src>(src));
+}
+} // namespace reaction
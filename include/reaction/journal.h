@@ -0,0 +1,298 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace reaction {
+// 序列化定制点: 用户可以为自己的类型特化size/write/read
+template <typename T>
+struct Serializer;
+
+template <typename T>
+    requires(std::is_trivially_copyable_v<T> && std::default_initializable<T>)
+struct Serializer<T> {
+    static size_t size(const T &) {
+        return sizeof(T);
+    }
+
+    static void write(const T &value, std::byte *out) {
+        std::memcpy(out, &value, sizeof(T));
+    }
+
+    static T read(std::span<const std::byte> in) {
+        T value;
+        std::memcpy(&value, in.data(), sizeof(T));
+        return value;
+    }
+};
+
+template <>
+struct Serializer<std::string> {
+    static size_t size(const std::string &value) {
+        return value.size();
+    }
+
+    static void write(const std::string &value, std::byte *out) {
+        std::memcpy(out, value.data(), value.size());
+    }
+
+    static std::string read(std::span<const std::byte> in) {
+        return std::string(reinterpret_cast<const char *>(in.data()), in.size());
+    }
+};
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct Serializer<std::vector<T>> {
+    static size_t size(const std::vector<T> &value) {
+        return value.size() * sizeof(T);
+    }
+
+    static void write(const std::vector<T> &value, std::byte *out) {
+        std::memcpy(out, value.data(), value.size() * sizeof(T));
+    }
+
+    static std::vector<T> read(std::span<const std::byte> in) {
+        std::vector<T> value(in.size() / sizeof(T));
+        std::memcpy(value.data(), in.data(), value.size() * sizeof(T));
+        return value;
+    }
+};
+
+// 文件布局: JournalHeader之后是连续的记录, 每条记录为JournalRecord + 负载, 按8字节对齐
+struct JournalHeader {
+    static constexpr uint64_t Magic = 0x4c4e524a54434552; // "RECTJRNL"
+    uint64_t magic;
+    uint64_t used; // 已提交的记录字节数, 读者只解析这部分
+};
+
+struct JournalRecord {
+    uint32_t id;
+    uint32_t size;
+    uint64_t timestamp; // system_clock纳秒
+};
+
+struct JournalEntry {
+    uint32_t id;
+    uint64_t timestamp;
+    std::span<const std::byte> data;
+};
+
+inline size_t journalAlign(size_t n) {
+    return (n + 7) & ~size_t{7};
+}
+
+// 追加写日志: 记录被跟踪的源结点的每次更新, 底层是按需扩容的内存映射文件
+class Journal {
+public:
+    explicit Journal(const std::string &path, size_t capacity = size_t{1} << 20) {
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0) {
+            REACTION_THROW(std::runtime_error("Failed to open journal: " + path));
+        }
+        map(std::max(journalAlign(capacity), sizeof(JournalHeader) + sizeof(JournalRecord)));
+        header()->magic = JournalHeader::Magic;
+        header()->used = 0;
+    }
+
+    ~Journal() {
+        for (auto &unhook : m_unhooks) { // 先停止记录, 再截断文件
+            unhook();
+        }
+        if (m_base) {
+            size_t length = sizeof(JournalHeader) + header()->used;
+            ::munmap(m_base, m_capacity);
+            [[maybe_unused]] int rc = ::ftruncate(m_fd, static_cast<off_t>(length));
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    // 跟踪一个源结点: 之后它的每次写入都以id写入日志(不记录当前的初始值).
+    // 挂在源结点的写入路径上, 同一轮传播中的多次写入逐条记录, 不同源之间保持真实的写入顺序
+    template <typename ReactType>
+    void record(const React<ReactType> &src, uint32_t id) {
+        static_assert(IsVarExpr<typename ReactType::ExprType>, "Only var nodes can be recorded.");
+        using Type = std::decay_t<typename ReactType::ValueType>;
+        auto ptr = src.getPtr();
+        auto hook = ptr->addWriteHook([this, id](const Type &value) { append(id, value); });
+        m_unhooks.push_back([weak = std::weak_ptr(ptr), hook] {
+            if (auto p = weak.lock()) {
+                p->removeWriteHook(hook);
+            }
+        });
+    }
+
+    template <typename T>
+    void append(uint32_t id, const T &value) {
+        size_t size = Serializer<T>::size(value);
+        size_t offset = sizeof(JournalHeader) + header()->used;
+        size_t length = journalAlign(sizeof(JournalRecord) + size);
+        if (offset + length > m_capacity) {
+            grow(offset + length);
+        }
+        auto record = m_base + offset;
+        JournalRecord head{id, static_cast<uint32_t>(size), timestamp()};
+        std::memcpy(record, &head, sizeof(head));
+        Serializer<T>::write(value, reinterpret_cast<std::byte *>(record + sizeof(JournalRecord)));
+        std::atomic_ref<uint64_t>(header()->used).store(header()->used + length, std::memory_order_release);
+        ++m_count;
+    }
+
+    size_t count() const {
+        return m_count;
+    }
+
+    size_t bytes() const {
+        return sizeof(JournalHeader) + header()->used;
+    }
+
+private:
+    static uint64_t timestamp() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    JournalHeader *header() const {
+        return reinterpret_cast<JournalHeader *>(m_base);
+    }
+
+    void map(size_t capacity) {
+        if (::ftruncate(m_fd, static_cast<off_t>(capacity)) != 0) {
+            REACTION_THROW(std::runtime_error("Failed to resize journal."));
+        }
+        void *base = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (base == MAP_FAILED) {
+            REACTION_THROW(std::runtime_error("Failed to map journal."));
+        }
+        m_base = static_cast<char *>(base);
+        m_capacity = capacity;
+    }
+
+    void grow(size_t required) {
+        size_t capacity = m_capacity;
+        while (capacity < required) {
+            capacity *= 2;
+        }
+        ::munmap(m_base, m_capacity);
+        m_base = nullptr;
+        map(capacity);
+    }
+
+    int m_fd = -1;
+    char *m_base = nullptr;
+    size_t m_capacity = 0;
+    size_t m_count = 0;
+    std::vector<std::function<void()>> m_unhooks;
+};
+
+// 只读映射一个日志文件, 顺序遍历其中的记录
+class JournalReader {
+public:
+    explicit JournalReader(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            REACTION_THROW(std::runtime_error("Failed to open journal: " + path));
+        }
+        struct stat st {};
+        ::fstat(fd, &st);
+        m_length = static_cast<size_t>(st.st_size);
+        if (m_length < sizeof(JournalHeader)) {
+            ::close(fd);
+            REACTION_THROW(std::runtime_error("Journal is truncated: " + path));
+        }
+        void *base = ::mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            REACTION_THROW(std::runtime_error("Failed to map journal: " + path));
+        }
+        m_base = static_cast<const char *>(base);
+        if (reinterpret_cast<const JournalHeader *>(m_base)->magic != JournalHeader::Magic) {
+            ::munmap(const_cast<char *>(m_base), m_length);
+            REACTION_THROW(std::runtime_error("Not a reaction journal: " + path));
+        }
+    }
+
+    ~JournalReader() {
+        ::munmap(const_cast<char *>(m_base), m_length);
+    }
+
+    JournalReader(const JournalReader &) = delete;
+    JournalReader &operator=(const JournalReader &) = delete;
+
+    template <typename F>
+    void forEach(F &&fun) const {
+        auto header = const_cast<JournalHeader *>(reinterpret_cast<const JournalHeader *>(m_base));
+        auto used = std::atomic_ref<uint64_t>(header->used).load(std::memory_order_acquire);
+        size_t end = std::min(m_length, sizeof(JournalHeader) + used);
+        for (size_t offset = sizeof(JournalHeader); offset + sizeof(JournalRecord) <= end;) {
+            JournalRecord head;
+            std::memcpy(&head, m_base + offset, sizeof(head));
+            auto data = reinterpret_cast<const std::byte *>(m_base + offset + sizeof(JournalRecord));
+            std::invoke(fun, JournalEntry{head.id, head.timestamp, {data, head.size}});
+            offset += journalAlign(sizeof(JournalRecord) + head.size);
+        }
+    }
+
+private:
+    const char *m_base = nullptr;
+    size_t m_length = 0;
+};
+
+// 回放驱动: 把日志中的更新按原顺序灌入新建的图, 可按批合并传播
+class Replayer {
+public:
+    explicit Replayer(const std::string &path) : m_reader(path) {}
+
+    // id应为较小的连续整数, 直接作为下标
+    template <typename ReactType>
+    void bind(uint32_t id, const React<ReactType> &src) {
+        using Type = std::decay_t<typename ReactType::ValueType>;
+        if (id >= m_handlers.size()) {
+            m_handlers.resize(id + 1);
+        }
+        m_handlers[id] = [ptr = src.getPtr()](std::span<const std::byte> data) {
+            ptr->value(Serializer<Type>::read(data));
+        };
+    }
+
+    // 返回实际回放的记录数; 未绑定的id被跳过
+    size_t run(size_t batchSize = 1) {
+        batchSize = std::max<size_t>(batchSize, 1);
+        size_t applied = 0;
+        std::optional<PassGuard> pass;
+        m_reader.forEach([&](const JournalEntry &entry) {
+            if (entry.id >= m_handlers.size() || !m_handlers[entry.id]) {
+                return;
+            }
+            if (!pass) {
+                pass.emplace();
+            }
+            m_handlers[entry.id](entry.data);
+            if (++applied % batchSize == 0) {
+                pass->finish();
+                pass.reset();
+            }
+        });
+        if (pass) {
+            pass->finish();
+        }
+        return applied;
+    }
+
+private:
+    JournalReader m_reader;
+    std::vector<std::function<void(std::span<const std::byte>)>> m_handlers;
+};
+} // namespace reaction
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <tuple>
+
+namespace reaction {
+template <typename T>
+concept Hashable = requires(const T &t) {
+    { std::hash<T>{}(t) } -> std::convertible_to<size_t>;
+};
+
+// 带有界结果缓存的函数对象: 以上游值的元组为键, 命中时直接返回缓存结果;
+// 容量很小, 用哈希值线性扫描查找, 满了以后按CLOCK算法淘汰最近未使用的条目
+template <size_t Capacity, typename Fun, typename Result, typename... Values>
+class MemoFun {
+public:
+    static_assert(Capacity > 0, "Memo cache capacity must be positive.");
+
+    explicit MemoFun(Fun fun) : m_fun(std::move(fun)) {
+        m_entries.reserve(Capacity);
+    }
+
+    Result operator()(const Values &...values) const {
+        size_t hash = hashOf(values...);
+        for (auto &entry : m_entries) {
+            if (entry.hash == hash && entry.key == std::tie(values...)) {
+                entry.referenced = true;
+                return entry.result;
+            }
+        }
+        Entry entry{hash, std::tuple<Values...>(values...), std::invoke(m_fun, values...), true};
+        Result result = entry.result;
+        if (m_entries.size() < Capacity) {
+            m_entries.push_back(std::move(entry));
+        } else {
+            while (m_entries[m_hand].referenced) {
+                m_entries[m_hand].referenced = false;
+                m_hand = (m_hand + 1) % Capacity;
+            }
+            m_entries[m_hand] = std::move(entry);
+            m_hand = (m_hand + 1) % Capacity;
+        }
+        return result;
+    }
+
+private:
+    static size_t hashOf(const Values &...values) {
+        size_t seed = 0;
+        ((seed ^= std::hash<Values>{}(values) + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2)), ...);
+        return seed;
+    }
+
+    struct Entry {
+        size_t hash;
+        std::tuple<Values...> key;
+        Result result;
+        bool referenced;
+    };
+
+    Fun m_fun;
+    mutable std::vector<Entry> m_entries;
+    mutable size_t m_hand = 0;
+};
+
+// 输入在少量取值间反复切换的昂贵计算: 以上游值为键缓存最近的Capacity个结果
+template <size_t Capacity = 32, typename Fun, typename... Args>
+    requires HasArguments<Args...>
+auto memoCalc(Fun &&fun, Args &&...args) {
+    using Result = std::invoke_result_t<std::decay_t<Fun> &, const typename std::decay_t<Args>::ValueType &...>;
+    static_assert(!VoidType<Result>, "memoCalc requires a functor that returns a value.");
+    static_assert((Hashable<typename std::decay_t<Args>::ValueType> && ...), "memoCalc requires std::hash for every upstream value type.");
+    using Memo = MemoFun<Capacity, std::decay_t<Fun>, Result, typename std::decay_t<Args>::ValueType...>;
+    return calc(Memo(std::forward<Fun>(fun)), std::forward<Args>(args)...);
+}
+} // namespace reaction
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <array>
+
+namespace reaction {
+// 全图的内存报告: 按结点种类汇总, 另外单列结点表和FieldGraph
+struct MemoryReport {
+    std::array<MemoryUsage, 5> kinds{};
+    MemoryUsage table;
+    MemoryUsage fields;
+
+    const MemoryUsage &operator[](NodeKind kind) const {
+        return kinds[static_cast<size_t>(kind)];
+    }
+
+    MemoryUsage total() const {
+        MemoryUsage usage = table;
+        usage += fields;
+        for (const auto &kind : kinds) {
+            usage += kind;
+        }
+        return usage;
+    }
+};
+
+// 遍历整张图做一次估算, 开销与结点数成正比, 用于诊断而不是热路径
+inline MemoryReport memoryReport() {
+    MemoryReport report;
+    auto &graph = ObserverGraph::getInstance();
+    graph.forEachNode([&report](const ObserverNode &node) {
+        report.kinds[static_cast<size_t>(node.kind())] += node.memoryUsage();
+    });
+    report.table = graph.tableMemory();
+    report.fields = FieldGraph::getInstance().memoryUsage();
+    return report;
+}
+
+// 分配计数: 这里只有计数接口. 全局operator new/delete(包括对齐版本)的替换在test/allocation/countingNew.cpp中,
+// 需要计数的程序把它作为源文件加入(整个程序只能有一份), 否则计数始终为0.
+// 在AddressSanitizer下运行时需设置ASAN_OPTIONS=alloc_dealloc_mismatch=0
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+inline AllocationStats &allocationStats() {
+    static thread_local AllocationStats stats;
+    return stats;
+}
+
+// 统计作用域内当前线程的分配次数和字节数, 用于断言每次更新的分配量
+class AllocationCounter {
+public:
+    AllocationCounter() : m_start(allocationStats()) {}
+
+    size_t allocations() const {
+        return allocationStats().allocations - m_start.allocations;
+    }
+
+    size_t bytes() const {
+        return allocationStats().bytes - m_start.bytes;
+    }
+
+private:
+    AllocationStats m_start;
+};
+} // namespace reaction
@@ -1,13 +1,138 @@
 #pragma once
 
 #include "reaction/concept.h"
+#include "reaction/expected.h"
 #include "reaction/utility.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
+#include <queue>
+#include <stdexcept>
+#include <vector>
 
 namespace reaction {
 
 using NodeSet = std::unordered_set<NodePtr>;
-using NodeSetRef = std::reference_wrapper<NodeSet>;
+using ObserverSet = std::unordered_set<ObserverNode *>; // 反向边只保存裸指针, 不延长观察者的生命周期
+
+// React句柄: 结点表中的(下标, 代数), 代数不符即失效; 代数0表示空句柄
+struct NodeHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+};
+
+// 内存统计: 结点数, 估算的堆字节数和分配次数
+struct MemoryUsage {
+    size_t nodes = 0;
+    size_t bytes = 0;
+    size_t allocations = 0;
+
+    MemoryUsage &operator+=(const MemoryUsage &other) {
+        nodes += other.nodes;
+        bytes += other.bytes;
+        allocations += other.allocations;
+        return *this;
+    }
+};
+
+// 按libstdc++的布局估算: 桶数组一次分配(只有一个桶时用内部存储), 每个元素一个链表结点
+template <typename Set>
+MemoryUsage hashSetMemory(const Set &set) {
+    MemoryUsage usage;
+    if (set.bucket_count() > 1) {
+        usage.bytes += set.bucket_count() * sizeof(void *);
+        usage.allocations += 1;
+    }
+    usage.bytes += set.size() * (sizeof(void *) + sizeof(typename Set::value_type));
+    usage.allocations += set.size();
+    return usage;
+}
+
+template <typename T>
+MemoryUsage vectorMemory(const std::vector<T> &vec) {
+    return {0, vec.capacity() * sizeof(T), vec.capacity() > 0 ? size_t{1} : size_t{0}};
+}
+
+enum class NodeKind : uint8_t {
+    Var,
+    Calc,
+    Action,
+    Expr,
+    Other,
+};
+
+// 传播优先级: 同一轮中先求值更紧急的类别; Low排在本轮最后, Idle留到runIdle()时再求值
+enum class Priority : uint8_t {
+    Critical,
+    Normal,
+    Low,
+    Idle,
+};
+
+class ObserverNode : public std::enable_shared_from_this<ObserverNode> // 使用enable_shared_from_this来支持shared_ptr
+{
+public:
+    ObserverNode() = default;
+    ObserverNode(const ObserverNode &) = delete;
+    ObserverNode &operator=(const ObserverNode &) = delete;
+
+    virtual ~ObserverNode(); // 虚函数需要一个虚析构
+
+    virtual void valueChanged() {
+        this->notify();
+    }
+
+    virtual void evaluate() {} // 只重新计算本结点的值, 不通知下游; 源结点没有计算
+
+    virtual NodeKind kind() const {
+        return NodeKind::Other;
+    }
+
+    // 估算本结点的内存: 这里只算边集合, 派生类再加上结点对象本身, 值和函数对象
+    virtual MemoryUsage memoryUsage() const {
+        MemoryUsage usage{1, 0, 0};
+        usage += hashSetMemory(m_observers);
+        usage += hashSetMemory(m_dependencies);
+        return usage;
+    }
+
+    template <typename... Args>
+    void updateObserver(Args &&...args);
+
+    void notify(); // 把观察者交给调度器, 在本轮传播中按拓扑高度依次求值
+
+    uint32_t rank() const {
+        return m_rank;
+    }
+
+    Priority priority() const {
+        return m_priority;
+    }
+
+    const NodeSet &dependencies() const {
+        return m_dependencies;
+    }
+
+    // 实际调度用的优先级: 继承所有下游中最紧急的类别, 保证上游不会晚于下游求值
+    Priority effectivePriority() const {
+        return m_effective;
+    }
+
+private:
+    static void reclaim(NodeSet &deps);
+
+    ObserverSet m_observers; // 观察本结点的下游结点(弱引用)
+    NodeSet m_dependencies;  // 本结点依赖的上游结点(强引用, 下游持有上游)
+    uint32_t m_rank = 0;     // 拓扑高度: 严格大于所有上游的高度
+    bool m_scheduled = false;
+    Priority m_priority = Priority::Normal;
+    Priority m_effective = Priority::Normal;
+    uint32_t m_slot = UINT32_MAX; // 在ObserverGraph结点表中的下标, 未登记时为UINT32_MAX
+
+    friend class ObserverGraph; // 允许ObserverGraph访问私有成员
+    friend class Scheduler;
+};
 
 class ObserverGraph { // 管理类，全局单例
 public:
@@ -16,96 +141,565 @@ public:
         return instance;
     }
 
+    // source观察target: source持有target的强引用, target只记录source的裸指针
     void addObserver(NodePtr source, NodePtr target) {
         if (source == target) {
-            throw std::runtime_error("Source and target cannot be the same node.");
+            REACTION_THROW(std::runtime_error("Source and target cannot be the same node."));
         }
 
-        if (hasCycle(source, target)) {
-            throw std::runtime_error("Adding this observer would create a cycle in the graph.");
+        if (hasCycle(source.get(), target.get())) {
+            REACTION_THROW(std::runtime_error("Adding this observer would create a cycle in the graph."));
         }
 
-        m_observerList.at(target).get().insert(source);
-        m_dependentList.at(source).insert(target);
+        target->m_observers.insert(source.get());
+        if (source->m_rank <= target->m_rank) {
+            raiseRank(source.get(), target->m_rank + 1);
+        }
+        inheritPriority(target.get(), source->m_effective);
+        source->m_dependencies.insert(std::move(target));
+    }
+
+    // 只加边, 不做环检测也不维护高度, 由validateNodes统一处理
+    void addObserverUnchecked(const NodePtr &source, NodePtr target) {
+        target->m_observers.insert(source.get());
+        inheritPriority(target.get(), source->m_effective);
+        source->m_dependencies.insert(std::move(target));
     }
 
-    void addNode(NodePtr node);
+    // 设置结点自身的优先级, 并重新计算它和上游的实际优先级
+    void setPriority(ObserverNode *node, Priority priority);
 
-    void removeNode(NodePtr node) {
-        m_observerList.erase(node);
-        m_dependentList.erase(node);
+    void removeObserver(const NodePtr &source, const NodePtr &target) {
+        target->m_observers.erase(source.get());
+        source->m_dependencies.erase(target);
     }
 
-private:
-    bool hasCycle(NodePtr source, NodePtr target) {
-        m_observerList.at(target).get().insert(source);
-        m_dependentList.at(source).insert(target);
-        NodeSet visited;
-        NodeSet stack;
+    // 用新的依赖集合替换source的旧依赖, 只增删有差异的边; targets需已排序去重
+    void updateDependency(const NodePtr &source, const std::vector<NodePtr> &targets) {
+        auto &deps = source->m_dependencies;
+        if (deps.size() == targets.size() && std::ranges::all_of(targets, [&](const NodePtr &t) { return deps.contains(t); })) {
+            return; // 依赖未变化, 快速路径
+        }
+
+        std::vector<NodePtr> removed;
+        for (const auto &dep : deps) {
+            if (!std::ranges::binary_search(targets, dep)) {
+                removed.push_back(dep);
+            }
+        }
+        for (const auto &dep : removed) {
+            removeObserver(source, dep);
+        }
+
+        std::vector<NodePtr> added;
+        REACTION_TRY {
+            for (const auto &target : targets) {
+                if (!deps.contains(target)) {
+                    addObserver(source, target);
+                    added.push_back(target);
+                }
+            }
+        } REACTION_CATCH_ALL { // 出现环时回滚, 保持图与旧依赖一致
+            for (const auto &target : added) {
+                removeObserver(source, target);
+            }
+            for (const auto &dep : removed) {
+                dep->m_observers.insert(source.get());
+                deps.insert(dep);
+            }
+            REACTION_RETHROW;
+        }
+    }
+
+    // 图的结点表持有所有仍被React句柄引用的结点, 返回结点的句柄; 已登记的结点返回原句柄.
+    // 结点表只能由构图线程修改; 其他线程(如分片线程)可以并发地解引用句柄, 前提是被引用的结点在此期间不会被移除
+    NodeHandle addNode(NodePtr node) {
+        if (node->m_slot != UINT32_MAX) {
+            return {node->m_slot, slotAt(node->m_slot).generation.load(std::memory_order_relaxed)};
+        }
+        uint32_t index;
+        if (!m_freeSlots.empty()) {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        } else {
+            index = m_slotCount;
+            ensureChunk(index >> ChunkBits);
+            ++m_slotCount;
+        }
+        auto &slot = slotAt(index);
+        node->m_slot = index;
+        slot.raw.store(node.get(), std::memory_order_release); // 复用槽位时, 读到新结点的读者一定能看到removeNode递增后的代数
+        slot.node = std::move(node);
+        ++m_liveNodes;
+        return {index, slot.generation.load(std::memory_order_relaxed)};
+    }
+
+    // 句柄全部释放后调用: 槽位的代数加一使旧句柄失效. 没有观察者的结点立即析构并从上游摘除,
+    // 仍被观察的结点由下游的强引用保活, 最后一个观察者释放时再回收
+    void removeNode(ObserverNode *node) {
+        if (node->m_slot == UINT32_MAX) {
+            return;
+        }
+        auto &slot = slotAt(node->m_slot);
+        NodePtr hold = std::move(slot.node); // 先整理好结点表, 级联析构中可能重入
+        uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+        slot.generation.store(generation == 0 ? 1 : generation, std::memory_order_release);
+        slot.raw.store(nullptr, std::memory_order_relaxed);
+        m_freeSlots.push_back(node->m_slot);
+        node->m_slot = UINT32_MAX;
+        --m_liveNodes;
+    }
+
+    // 句柄的解引用: 定位分块后比较代数, 失效时返回nullptr.
+    // 分块一经分配就不再移动, 所以读者不会看到扩容中的表; 这里只有普通的load, 没有原子读改写.
+    // 读出结点后再确认一次代数: 槽位在两次读取之间被释放并复用时返回nullptr, 不会把新结点当成旧句柄的结点.
+    // 返回的指针只在结点未被移除期间有效, 结点的存活需要调用者保证
+    ObserverNode *lookup(NodeHandle handle) const {
+        auto chunk = m_chunks[handle.index >> ChunkBits].load(std::memory_order_acquire);
+        if (!chunk) {
+            return nullptr;
+        }
+        auto &slot = chunk[handle.index & ChunkMask];
+        if (slot.generation.load(std::memory_order_acquire) != handle.generation) {
+            return nullptr;
+        }
+        auto raw = slot.raw.load(std::memory_order_acquire);
+        if (slot.generation.load(std::memory_order_relaxed) != handle.generation) {
+            return nullptr;
+        }
+        return raw;
+    }
+
+    void reserve(size_t count) {
+        size_t last = std::min<size_t>(m_slotCount + count, size_t{MaxChunks} << ChunkBits);
+        for (size_t c = m_slotCount >> ChunkBits; (c << ChunkBits) < last; ++c) {
+            ensureChunk(static_cast<uint32_t>(c));
+        }
+        m_freeSlots.reserve(m_freeSlots.size() + count);
+    }
+
+    size_t size() const {
+        return m_liveNodes;
+    }
 
-        bool isCycle = dfs(source, visited, stack);
-        m_observerList.at(target).get().erase(source);
-        m_dependentList.at(source).erase(target);
-        return isCycle;
+    // 批量建图的提交: 对一组新结点做一次拓扑排序(只能依赖已有结点或组内结点),
+    // 有环时抛异常; 否则按拓扑序设置高度并返回求值顺序
+    std::vector<ObserverNode *> validateNodes(const std::vector<NodePtr> &nodes) {
+        std::unordered_map<ObserverNode *, size_t> indegree;
+        indegree.reserve(nodes.size());
+        for (const auto &node : nodes) {
+            indegree.emplace(node.get(), 0);
+        }
+        std::vector<ObserverNode *> order;
+        order.reserve(nodes.size());
+        for (const auto &node : nodes) {
+            auto &degree = indegree[node.get()];
+            for (const auto &dep : node->m_dependencies) {
+                degree += indegree.contains(dep.get());
+            }
+            if (degree == 0) {
+                order.push_back(node.get());
+            }
+        }
+        for (size_t head = 0; head < order.size(); ++head) {
+            for (auto observer : order[head]->m_observers) {
+                if (auto it = indegree.find(observer); it != indegree.end() && --it->second == 0) {
+                    order.push_back(observer);
+                }
+            }
+        }
+        if (order.size() != nodes.size()) {
+            REACTION_THROW(std::runtime_error("Adding these nodes would create a cycle in the graph."));
+        }
+        for (auto node : order) {
+            node->m_rank = 0;
+            for (const auto &dep : node->m_dependencies) {
+                node->m_rank = std::max(node->m_rank, dep->m_rank + 1);
+            }
+        }
+        return order;
+    }
+
+    // 断开结点的所有依赖边, 用于撤销未提交的结点
+    void unlinkNode(const NodePtr &node) {
+        for (const auto &dep : node->m_dependencies) {
+            dep->m_observers.erase(node.get());
+        }
+        node->m_dependencies.clear();
     }
 
-    bool dfs(NodePtr node, NodeSet &visited, NodeSet &stack) {
-        if (stack.contains(node)) {
-            return true; // Cycle detected
+    // 访问所有与结点表连通的存活结点: 沿上游边找到句柄已释放但仍被下游持有的结点,
+    // 沿下游边找到只由外部NodePtr持有的结点. 与图完全不连通的孤立NodePtr不计入
+    template <typename F>
+    void forEachNode(F &&fun) const {
+        std::unordered_set<const ObserverNode *> visited;
+        std::vector<const ObserverNode *> stack;
+        for (uint32_t i = 0; i < m_slotCount; ++i) {
+            if (const auto &slot = slotAt(i); slot.node) {
+                stack.push_back(slot.node.get());
+            }
         }
-        if (visited.contains(node)) {
-            return false; // Already visited
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            if (!visited.insert(node).second) {
+                continue;
+            }
+            std::invoke(fun, *node);
+            for (const auto &dep : node->m_dependencies) {
+                stack.push_back(dep.get());
+            }
+            for (auto observer : node->m_observers) { // 只被外部NodePtr持有的结点(镜像, 通道, 休眠的Idle结点)经由下游边找到
+                stack.push_back(observer);
+            }
         }
+    }
+
+    // 结点表和空闲槽位链自身的内存
+    MemoryUsage tableMemory() const {
+        size_t chunks = (m_slotCount + ChunkSize - 1) >> ChunkBits;
+        MemoryUsage usage{0, chunks * ChunkSize * sizeof(NodeSlot), chunks};
+        usage += vectorMemory(m_freeSlots);
+        return usage;
+    }
 
-        visited.insert(node);
-        stack.insert(node);
+    // 已提交的传播轮次; 正在进行的一轮传播写入的是epoch() + 1
+    uint64_t epoch() const {
+        return m_epoch.load();
+    }
+
+    void commitEpoch() {
+        m_epoch.fetch_add(1);
+    }
+
+private:
+    // 加边后维护拓扑高度; 删边时不降低高度, 高度仍是合法的拓扑序
+    void raiseRank(ObserverNode *node, uint32_t rank) {
+        std::vector<std::pair<ObserverNode *, uint32_t>> stack{{node, rank}};
+        while (!stack.empty()) {
+            auto [n, r] = stack.back();
+            stack.pop_back();
+            if (n->m_rank >= r) {
+                continue;
+            }
+            n->m_rank = r;
+            for (auto observer : n->m_observers) {
+                stack.emplace_back(observer, r + 1);
+            }
+        }
+    }
 
-        for (const auto &neighbor : m_observerList.at(node).get()) {
-            if (dfs(neighbor, visited, stack)) {
-                return true;
+    // 加边后上游继承下游的优先级; 删边时不降级, 与高度一样保持保守但合法
+    void inheritPriority(ObserverNode *node, Priority priority) {
+        std::vector<ObserverNode *> stack{node};
+        while (!stack.empty()) {
+            auto n = stack.back();
+            stack.pop_back();
+            if (n->m_effective <= priority) {
+                continue;
+            }
+            n->m_effective = priority;
+            for (const auto &dep : n->m_dependencies) {
+                stack.push_back(dep.get());
             }
         }
+    }
 
-        stack.erase(node);
+    // 新边target->source成环, 当且仅当沿观察者方向能从source走到target
+    bool hasCycle(ObserverNode *source, ObserverNode *target) {
+        std::unordered_set<ObserverNode *> visited;
+        std::vector<ObserverNode *> stack{source};
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            if (node == target) {
+                return true; // Cycle detected
+            }
+            if (!visited.insert(node).second) {
+                continue; // Already visited
+            }
+            for (auto neighbor : node->m_observers) {
+                stack.push_back(neighbor);
+            }
+        }
         return false;
     }
 
     ObserverGraph() = default;
-    std::unordered_map<NodePtr, NodeSetRef> m_observerList;
-    std::unordered_map<NodePtr, NodeSet> m_dependentList;
+
+    ~ObserverGraph() {
+        for (uint32_t i = 0; i < m_slotCount; ++i) { // 先释放结点, 析构中可能重入结点表
+            NodePtr hold = std::move(slotAt(i).node);
+        }
+        for (auto &chunk : m_chunks) {
+            delete[] chunk.load();
+        }
+    }
+
+    // 结点表按固定大小分块分配, 分块地址永不改变; raw和generation供其他线程读取
+    struct NodeSlot {
+        NodePtr node;
+        std::atomic<ObserverNode *> raw{nullptr};
+        std::atomic<uint32_t> generation{1};
+    };
+
+    static constexpr uint32_t ChunkBits = 12;
+    static constexpr uint32_t ChunkSize = 1u << ChunkBits;
+    static constexpr uint32_t ChunkMask = ChunkSize - 1;
+    static constexpr uint32_t MaxChunks = 4096; // 最多约1600万个结点
+
+    NodeSlot &slotAt(uint32_t index) const {
+        return m_chunks[index >> ChunkBits].load(std::memory_order_relaxed)[index & ChunkMask];
+    }
+
+    void ensureChunk(uint32_t chunk) {
+        if (chunk >= MaxChunks) {
+            REACTION_THROW(std::runtime_error("Node table is full."));
+        }
+        if (!m_chunks[chunk].load(std::memory_order_relaxed)) {
+            m_chunks[chunk].store(new NodeSlot[ChunkSize], std::memory_order_release);
+        }
+    }
+
+    std::array<std::atomic<NodeSlot *>, MaxChunks> m_chunks{};
+    uint32_t m_slotCount = 0;
+    std::vector<uint32_t> m_freeSlots;
+    size_t m_liveNodes = 0;
+    std::atomic<uint64_t> m_epoch{1};
 };
 
-class ObserverNode : public std::enable_shared_from_this<ObserverNode> // 使用enable_shared_from_this来支持shared_ptr
-{
+// 传播调度器: 每个线程一个, 按(优先级, 拓扑高度)从小到大求值, 同一轮中每个结点最多求值一次(无毛刺).
+// 上游的实际优先级不低于下游, 所以这个顺序仍是拓扑序
+class Scheduler {
 public:
-    ~ObserverNode() = default; // 虚函数需要一个虚析构
+    static Scheduler &getInstance() {
+        static thread_local Scheduler instance;
+        return instance;
+    }
 
-    virtual void valueChanged() {
-        this->notify();
+    void schedule(ObserverNode *node) {
+        if (!node->m_scheduled) {
+            node->m_scheduled = true;
+            if (node->m_effective == Priority::Idle && !m_idlePass) {
+                m_idle.emplace_back(node->shared_from_this()); // 跨轮次保留, 需要保活
+            } else {
+                m_queue.emplace(key(node), node->shared_from_this()); // 本轮中先求值的结点可能释放排在后面的结点
+            }
+        }
     }
 
-    template <typename... Args>
-    void updateObserver(Args &&...args) {
-        auto self = this->shared_from_this();
-        (ObserverGraph::getInstance().addObserver(self, args), ...);
+    // 在一轮新的传播中求值积压的Idle结点, 返回是否有积压
+    bool runIdle();
+
+    // 不再是Idle的结点: 从积压中取出, 在一轮传播中按新的优先级补上错过的求值
+    void promote(const std::vector<ObserverNode *> &nodes);
+
+    bool hasIdleWork() const {
+        return !m_idle.empty();
     }
 
-    void notify() {
-        for (auto observer : m_observers) {
-            observer->valueChanged();
+    void drain() {
+        while (!m_queue.empty()) {
+            NodePtr node = m_queue.top().second;
+            m_queue.pop();
+            node->m_scheduled = false;
+            if (node.use_count() > 1) { // 只剩队列持有时结点已被丢弃, 不再求值
+                node->valueChanged();
+            }
+        }
+    }
+
+    void clear() {
+        while (!m_queue.empty()) {
+            m_queue.top().second->m_scheduled = false;
+            m_queue.pop();
         }
     }
 
 private:
-    NodeSet m_observers;
+    Scheduler() = default;
 
-    friend class ObserverGraph; // 允许ObserverGraph访问私有成员
+    static uint64_t key(const ObserverNode *node) {
+        return (uint64_t(node->m_effective) << 32) | node->m_rank;
+    }
+
+    using Item = std::pair<uint64_t, NodePtr>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> m_queue;
+    std::vector<NodePtr> m_idle;
+    bool m_idlePass = false;
+};
+
+// 标记一轮传播: 源结点的更新及其引起的通知链; 嵌套时只有最外层负责排空调度队列并提交epoch(仅限拥有epoch的线程)
+class PassGuard {
+public:
+    PassGuard() {
+        if (depth()++ == 0) {
+            ++serial();
+        }
+    }
+
+    ~PassGuard() {
+        if (--depth() == 0) {
+            if (!m_finished) {
+                Scheduler::getInstance().clear(); // 异常退出时丢弃未完成的调度
+            }
+            if (ownsEpoch()) {
+                ObserverGraph::getInstance().commitEpoch();
+            }
+        }
+    }
+
+    PassGuard(const PassGuard &) = delete;
+    PassGuard &operator=(const PassGuard &) = delete;
+
+    // 正常结束本轮: 最外层在这里执行所有已调度的求值, 求值中的异常会抛给调用者
+    void finish() {
+        if (depth() == 1) {
+            Scheduler::getInstance().drain();
+        }
+        m_finished = true;
+    }
+
+    static bool active() {
+        return depth() > 0;
+    }
+
+    // 当前线程上的传播轮次编号, 每开始一轮最外层传播加一
+    static uint64_t current() {
+        return serial();
+    }
+
+    // 全局epoch只有一个写者: 分片等独立传播线程调用detachEpoch后, 本线程的传播不再提交epoch
+    static void detachEpoch() {
+        epochOwner() = false;
+    }
+
+    static bool ownsEpoch() {
+        return epochOwner();
+    }
+
+private:
+    static int &depth() {
+        static thread_local int t_depth = 0;
+        return t_depth;
+    }
+
+    static uint64_t &serial() {
+        static thread_local uint64_t t_serial = 0;
+        return t_serial;
+    }
+
+    static bool &epochOwner() {
+        static thread_local bool t_owner = true;
+        return t_owner;
+    }
+
+    bool m_finished = false;
 };
 
-inline void ObserverGraph::addNode(NodePtr node) {
-    m_observerList.insert({node, std::ref(node->m_observers)});
-    m_dependentList.insert({node, NodeSet{}});
+inline bool Scheduler::runIdle() {
+    if (m_idle.empty()) {
+        return false;
+    }
+    auto idle = std::move(m_idle);
+    m_idle.clear();
+    m_idlePass = true;
+    struct Reset {
+        bool &flag;
+        ~Reset() { flag = false; }
+    } reset{m_idlePass};
+    PassGuard pass;
+    for (auto &node : idle) {
+        m_queue.emplace(key(node.get()), std::move(node));
+    }
+    pass.finish();
+    return true;
+}
+
+inline void Scheduler::promote(const std::vector<ObserverNode *> &nodes) {
+    PassGuard pass;
+    for (auto node : nodes) {
+        auto it = std::ranges::find_if(m_idle, [node](const NodePtr &idle) { return idle.get() == node; });
+        if (it != m_idle.end()) { // 仍然保持m_scheduled, 避免在本轮中重复入队
+            m_queue.emplace(key(node), std::move(*it));
+            m_idle.erase(it);
+        }
+    }
+    pass.finish();
+}
+
+inline void ObserverGraph::setPriority(ObserverNode *node, Priority priority) {
+    node->m_priority = priority;
+    std::vector<ObserverNode *> promoted;
+    std::vector<ObserverNode *> stack{node};
+    while (!stack.empty()) {
+        auto n = stack.back();
+        stack.pop_back();
+        auto effective = n->m_priority;
+        for (auto observer : n->m_observers) {
+            effective = std::min(effective, observer->m_effective);
+        }
+        if (n == node || effective != n->m_effective) {
+            if (n->m_effective == Priority::Idle && effective != Priority::Idle && n->m_scheduled) {
+                promoted.push_back(n); // 积压在Idle队列中, 不会再被schedule()入队
+            }
+            n->m_effective = effective;
+            for (const auto &dep : n->m_dependencies) {
+                stack.push_back(dep.get());
+            }
+        }
+    }
+    if (!promoted.empty()) {
+        Scheduler::getInstance().promote(promoted);
+    }
+}
+
+inline void ObserverNode::notify() {
+    if (!PassGuard::active()) {
+        PassGuard pass;
+        notify();
+        pass.finish();
+        return;
+    }
+    auto &scheduler = Scheduler::getInstance();
+    for (auto observer : m_observers) {
+        scheduler.schedule(observer);
+    }
+}
+
+template <typename... Args>
+void ObserverNode::updateObserver(Args &&...args) {
+    auto self = this->shared_from_this();
+    (ObserverGraph::getInstance().addObserver(self, args), ...);
 }
+
+inline ObserverNode::~ObserverNode() {
+    // 观察者都持有本结点的强引用, 因此析构时m_observers必为空, 只需从上游摘除自己
+    for (const auto &dep : m_dependencies) {
+        dep->m_observers.erase(this);
+    }
+    reclaim(m_dependencies);
+}
+
+// 释放上游引用可能引发级联析构, 用显式队列展开, 避免长链导致的深递归
+inline void ObserverNode::reclaim(NodeSet &deps) {
+    static thread_local std::vector<NodePtr> *t_pending = nullptr;
+    if (t_pending) {
+        t_pending->insert(t_pending->end(), deps.begin(), deps.end());
+        deps.clear();
+        return;
+    }
+    std::vector<NodePtr> pending(deps.begin(), deps.end());
+    deps.clear();
+    t_pending = &pending;
+    while (!pending.empty()) {
+        auto node = std::move(pending.back());
+        pending.pop_back();
+        node.reset();
+    }
+    t_pending = nullptr;
+}
+
 class FieldGraph {
 public:
     static FieldGraph &getInstance() {
@@ -114,24 +708,41 @@ public:
     }
 
     void addObj(const uint64_t &id, NodePtr node) {
-        m_fieldMap[id].insert(node);
+        m_fieldMap[id].push_back(node);
     }
 
     void deleteObj(const uint64_t &id) {
         m_fieldMap.erase(id);
     }
 
+    MemoryUsage memoryUsage() const {
+        using Entry = std::pair<const uint64_t, std::vector<std::weak_ptr<ObserverNode>>>;
+        MemoryUsage usage;
+        if (m_fieldMap.bucket_count() > 1) {
+            usage.bytes += m_fieldMap.bucket_count() * sizeof(void *);
+            usage.allocations += 1;
+        }
+        for (const auto &[id, nodes] : m_fieldMap) {
+            usage.bytes += sizeof(void *) + sizeof(Entry);
+            usage.allocations += 1;
+            usage += vectorMemory(nodes);
+        }
+        return usage;
+    }
+
     void bindField(const uint64_t &id, NodePtr node) {
         if (!m_fieldMap.contains(id)) {
             return;
         }
-        for (auto &n : m_fieldMap[id]) {
-            ObserverGraph::getInstance().addObserver(node, n);
+        for (auto &weak : m_fieldMap[id]) {
+            if (auto n = weak.lock()) {
+                ObserverGraph::getInstance().addObserver(node, n);
+            }
         }
     }
 
 private:
     FieldGraph() = default;
-    std::unordered_map<uint64_t, NodeSet> m_fieldMap;
+    std::unordered_map<uint64_t, std::vector<std::weak_ptr<ObserverNode>>> m_fieldMap; // 不延长字段结点的生命周期
 };
-} // namespace reaction
\ No newline at end of file
+} // namespace reaction
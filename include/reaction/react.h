@@ -1,22 +1,8 @@
 #pragma once
 
 #include "reaction/expression.h"
-#include <atomic>
 
 namespace reaction {
-inline thread_local std::function<void(NodePtr)> g_reg_fun = nullptr; // 全局注册函数，用于注册回调
-
-struct RegGuard {
-public:
-    RegGuard(const std::function<void(NodePtr)> &reg_fun) {
-        g_reg_fun = reg_fun; // 设置全局注册函数
-    }
-
-    ~RegGuard() {
-        g_reg_fun = nullptr; // 清除注册函数
-    }
-};
-
 template <typename Type, typename... Args>
 class ReactImpl : public Expression<Type, Args...> // 用来和用户交互, 采用继承的方式表示is a的关系
 {                                                  // 实现类
@@ -25,8 +11,19 @@ public:
     using ValueType = Expression<Type, Args...>::ValueType;
     ReactImpl(const ReactImpl &d) {}
     using Expression<Type, Args...>::Expression;
-    decltype(auto) get() const { // 完全保留返回值的类型
-        return this->getValue();
+    decltype(auto) get() const { // 只读访问, 返回const引用避免拷贝
+        if constexpr (VoidType<ValueType>) {
+            return this->getValue();
+        } else {
+            return std::as_const(this->getValue());
+        }
+    }
+
+    // 不抛异常的读取: 值尚未初始化时返回nullptr
+    const ValueType *tryGet() const
+        requires(!VoidType<ValueType>)
+    {
+        return this->hasValue() ? &this->getValue() : nullptr;
     }
 
     template <typename F, HasArguments... A>
@@ -35,17 +32,11 @@ public:
     }
 
     template <typename F>
-    void set(F &&fun) {
-        RegGuard guard([this](NodePtr obj) {
-            this->addObjCb(obj);
-        }); // 注册函数
+    void set(F &&fun) { // 无参数: 在每次求值时自动追踪依赖
         this->setSource(std::forward<F>(fun));
     }
 
     void set() {
-        RegGuard guard([this](NodePtr obj) {
-            this->addObjCb(obj);
-        }); // 注册函数
         this->setOpExpr();
     }
 
@@ -61,88 +52,128 @@ public:
     template <typename T>
         requires(Convertable<T, ValueType> && IsVarExpr<ExprType> && !ConstType<ValueType>)
     void value(T &&t) {
+        PassGuard pass;
         this->updateValue(std::forward<T>(t));
+        this->runWriteHooks();
         this->notify();
+        pass.finish();
     }
 
-    void addWeakRef() {
-        m_weakRefCount++;
+    // 原地修改源结点的值后通知下游, 避免整值拷贝
+    template <typename F>
+        requires(std::invocable<F, ValueType &> && IsVarExpr<ExprType> && !ConstType<ValueType>)
+    void update(F &&fun) {
+        PassGuard pass;
+        std::invoke(std::forward<F>(fun), this->getValue());
+        this->runWriteHooks();
+        this->notify();
+        pass.finish();
     }
 
-    void releaseWeakRef() {
-        if (--m_weakRefCount == 0) {
-            ObserverGraph::getInstance().removeNode(std::static_pointer_cast<ObserverNode>(this->shared_from_this()));
+    NodeKind kind() const override {
+        if constexpr (IsVarExpr<ExprType>) {
+            return NodeKind::Var;
+        } else if constexpr (IsBinaryOpExpr<Type>) {
+            return NodeKind::Expr;
+        } else if constexpr (VoidType<ValueType>) {
+            return NodeKind::Action;
+        } else {
+            return NodeKind::Calc;
+        }
+    }
+
+    MemoryUsage memoryUsage() const override {
+        constexpr size_t SharedBlockOverhead = 2 * sizeof(void *); // make_shared控制块的引用计数和虚表
+        auto usage = ObserverNode::memoryUsage();
+        usage.bytes += sizeof(*this) + SharedBlockOverhead;
+        usage.allocations += 1;
+        if constexpr (!VoidType<ValueType>) {
+            if (this->hasValue()) {
+                usage.bytes += sizeof(ValueType); // 值本身的堆内存(如字符串内容)无法通用地统计
+                usage.allocations += 1;
+            }
+        }
+        if constexpr (!IsVarExpr<ExprType>) {
+            usage.bytes += this->functorHeapBytes();
+            usage.allocations += this->functorHeapBytes() > 0;
+        }
+        return usage;
+    }
+
+    void addHandleRef() {
+        m_handleCount++;
+    }
+
+    void releaseHandleRef() {
+        if (--m_handleCount == 0) {
             if constexpr (HasField<ValueType>) {
                 FieldGraph::getInstance().deleteObj(this->getValue().getID());
             }
+            ObserverGraph::getInstance().removeNode(this); // 可能析构本结点, 之后不能再访问成员
         }
     }
 
 private:
-    std::atomic<int> m_weakRefCount{0}; // 引用计数，线程安全
+    uint32_t m_handleCount = 0; // 句柄计数; 只在构图线程上改动, 不需要原子操作
 };
 
+// 管理类: 8字节的(下标, 代数)句柄, 解引用不涉及原子读改写.
+// 解引用(get/operator()/value等)可以在其他线程进行, 包括构图线程同时在建新结点时,
+// 但只限于结点保证存活的期间: 没有任何机制阻止构图线程在解引用的同时释放最后一个句柄并回收结点.
+// 句柄的创建, 拷贝和析构会改动句柄计数和结点表, 只能在构图线程上进行
 template <typename ReactType>
-class React // 管理类
+class React
 {
 public:
     using ValueType = typename ReactType::ValueType;
     ReactType &operator*() {
-        return *getPtr();
+        return *checked();
     }
 
-    explicit React(std::shared_ptr<ReactType> ptr = nullptr) : m_weakPtr(ptr) {
-        if (auto p = m_weakPtr.lock()) {
-            p->addWeakRef();
+    explicit React(std::shared_ptr<ReactType> ptr = nullptr) {
+        if (ptr) {
+            m_handle = ObserverGraph::getInstance().addNode(ptr);
+            ptr->addHandleRef();
         }
     }
 
     ~React() {
-        if (auto p = m_weakPtr.lock()) {
-            p->releaseWeakRef();
-        }
+        release();
     }
 
-    React(const React &other) : m_weakPtr(other.m_weakPtr) {
-        if (auto p = m_weakPtr.lock()) {
-            p->addWeakRef();
+    React(const React &other) : m_handle(other.m_handle) {
+        if (auto p = node()) {
+            p->addHandleRef();
         }
     }
 
     React &operator=(const React &other) {
         if (this != &other) {
-            if (auto p = m_weakPtr.lock()) {
-                p->releaseWeakRef();
-            }
-            m_weakPtr = other.m_weakPtr;
-            if (auto p = m_weakPtr.lock()) {
-                p->addWeakRef();
+            if (auto p = other.node()) {
+                p->addHandleRef();
             }
+            release();
+            m_handle = other.m_handle;
         }
         return *this;
     }
 
-    React(React &&other) noexcept : m_weakPtr(std::move(other.m_weakPtr)) {
-        other.m_weakPtr.reset();
-    }
+    React(React &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
 
     React &operator=(React &&other) noexcept {
         if (this != &other) {
-            if (auto p = m_weakPtr.lock()) {
-                p->releaseWeakRef();
-            }
-            m_weakPtr = std::move(other.m_weakPtr);
-            other.m_weakPtr.reset();
+            release();
+            m_handle = std::exchange(other.m_handle, {});
         }
         return *this;
     }
 
     operator bool() const {
-        return !m_weakPtr.expired();
+        return node() != nullptr;
     }
 
     decltype(auto) get() const {
-        return getPtr()->get();
+        return checked()->get();
     }
 
     decltype(auto) operator()() const {
@@ -152,31 +183,97 @@ public:
         return get();
     }
 
+    // 不抛异常的读取: 结点已失效或值尚未初始化时返回nullptr
+    const ValueType *tryGet() const
+        requires(!VoidType<ValueType>)
+    {
+        auto p = node();
+        return p ? p->tryGet() : nullptr;
+    }
+
     template <typename F, typename... A>
     void reset(F &&fun, A &&...args) {
-        getPtr()->set(std::forward<F>(fun), std::forward<A>(args)...);
+        checked()->set(std::forward<F>(fun), std::forward<A>(args)...);
     }
 
     template <typename T>
     void value(T &&t) {
-        return getPtr()->value(std::forward<T>(t));
+        return checked()->value(std::forward<T>(t));
     }
 
-    auto getPtr() const {
-        if (auto p = m_weakPtr.lock()) {
-            return p;
-        }
-        throw std::runtime_error("Weak pointer expired");
+    template <typename F>
+    void update(F &&fun) {
+        return checked()->update(std::forward<F>(fun));
+    }
+
+    // 设置传播优先级, 上游结点会自动继承更紧急的类别
+    void setPriority(Priority priority) {
+        ObserverGraph::getInstance().setPriority(checked(), priority);
+    }
+
+    // 需要长期持有结点时使用(如捕获进函数对象), 会产生一次shared_ptr拷贝
+    std::shared_ptr<ReactType> getPtr() const {
+        return std::static_pointer_cast<ReactType>(checked()->shared_from_this());
     }
 
     auto operator->() const {
-        return getPtr()->getRaw();
+        return checked()->getRaw();
     }
 
 private:
-    std::weak_ptr<ReactType> m_weakPtr;
+    ReactType *node() const {
+        return static_cast<ReactType *>(ObserverGraph::getInstance().lookup(m_handle));
+    }
+
+    ReactType *checked() const {
+        if (auto p = node()) {
+            return p;
+        }
+        REACTION_THROW(std::runtime_error("React handle expired"));
+    }
+
+    void release() {
+        if (auto p = node()) {
+            p->releaseHandleRef();
+        }
+        m_handle = {};
+    }
+
+    NodeHandle m_handle;
 };
 
+// 观察src: 每轮传播中src变化后以其值调用fun. 返回的NodePtr是观察结点的唯一持有者,
+// 释放它即取消观察; 结点不占用React句柄. skipInitial为真时跳过创建时的首次调用
+template <typename ReactType, typename F>
+NodePtr observe(const React<ReactType> &src, F &&fun, bool skipInitial = false) {
+    using Type = std::decay_t<typename ReactType::ValueType>;
+    struct Observer {
+        mutable std::decay_t<F> fun;
+        mutable bool armed;
+
+        void operator()(const Type &value) const {
+            if (armed) {
+                std::invoke(fun, value);
+            }
+            armed = true;
+        }
+    };
+    return action(Observer{std::forward<F>(fun), !skipInitial}, src).getPtr();
+}
+
+// 批量更新: fun中的所有value()/update()合并为一轮传播, 结束时每个受影响的结点只求值一次
+template <typename F>
+void batch(F &&fun) {
+    PassGuard pass;
+    std::invoke(std::forward<F>(fun));
+    pass.finish();
+}
+
+// 求值积压的Idle优先级结点(合并为一轮传播), 应在空闲时且不在传播中调用; 返回是否有积压
+inline bool runIdle() {
+    return Scheduler::getInstance().runIdle();
+}
+
 template <typename SrcType>
 using Field = React<ReactImpl<std::decay_t<SrcType>>>; // Field是一个React类型的别名，表示一个字段
 class FieldBase {
@@ -230,6 +327,62 @@ auto calc(Func &&fun, Args &&...args) {
     return React(ptr);
 }
 
+// tryCalc的函数对象包装: 任一上游为错误时直接转发第一个错误, 不调用用户函数;
+// 否则以解包后的值调用, 用户函数抛出的异常也转成错误值, 不会在传播过程中展开
+template <typename Fun, typename Result, typename... Values>
+struct TryFun {
+    Fun fun;
+
+    Expected<Result> operator()(const Values &...values) const {
+        const Error *error = nullptr;
+        ((error = error ? error : errorOf(values)), ...);
+        if (error) {
+            return *error;
+        }
+#if REACTION_EXCEPTIONS
+        try {
+            return std::invoke(fun, unwrap(values)...);
+        } catch (const std::exception &e) {
+            return Error{e.what()};
+        } catch (...) {
+            return Error{"Unknown exception"};
+        }
+#else
+        return std::invoke(fun, unwrap(values)...);
+#endif
+    }
+
+private:
+    template <typename T>
+    static const Error *errorOf(const T &value) {
+        if constexpr (IsExpected<T>) {
+            return value.hasValue() ? nullptr : &value.error();
+        } else {
+            return nullptr;
+        }
+    }
+
+    template <typename T>
+    static const auto &unwrap(const T &value) {
+        if constexpr (IsExpected<T>) {
+            return value.value();
+        } else {
+            return value;
+        }
+    }
+};
+
+// 值为Expected<R>的计算结点: 上游可以是普通结点或Expected结点, fun接收解包后的值,
+// 可以返回R, 也可以返回Expected<R>主动报告错误. 错误作为值沿图传播, 下游照常被调度
+template <typename Func, typename... Args>
+    requires HasArguments<Args...>
+auto tryCalc(Func &&fun, Args &&...args) {
+    using Result = UnwrapExpected<std::invoke_result_t<std::decay_t<Func> &, const UnwrapExpected<typename std::decay_t<Args>::ValueType> &...>>;
+    static_assert(!std::is_void_v<Result>, "tryCalc requires a functor that returns a value.");
+    using Wrapper = TryFun<std::decay_t<Func>, Result, typename std::decay_t<Args>::ValueType...>;
+    return calc(Wrapper{std::forward<Func>(fun)}, std::forward<Args>(args)...);
+}
+
 template <typename Func, typename... Args>
 auto action(Func &&fun, Args &&...args) {
     return calc(std::forward<Func>(fun), std::forward<Args>(args)...);
@@ -20,14 +20,18 @@ public:
 
     Type &getValue() const {
         if (!m_ptr) {
-            throw std::runtime_error("Resource is not initialized");
+            REACTION_THROW(std::runtime_error("Resource is not initialized"));
         }
         return *m_ptr;
     }
 
+    bool hasValue() const {
+        return m_ptr != nullptr;
+    }
+
     Type *getRawPtr() const {
         if (!m_ptr) {
-            throw std::runtime_error("Resource is not initialized");
+            REACTION_THROW(std::runtime_error("Resource is not initialized"));
         }
         return m_ptr.get();
     }
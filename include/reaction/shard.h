@@ -0,0 +1,178 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <array>
+#include <thread>
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+namespace reaction {
+// 单生产者单消费者无锁环形队列; 生产者和消费者各自缓存对方的下标, 减少缓存行往返
+template <typename T, size_t Capacity = 1024>
+class SpscQueue {
+public:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two.");
+
+    bool push(const T &value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity) {
+                return false;
+            }
+        }
+        m_buffer[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(m_buffer[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> m_head{0}; // 消费者写
+    alignas(64) size_t m_cachedTail = 0;       // 消费者私有
+    alignas(64) std::atomic<size_t> m_tail{0}; // 生产者写
+    alignas(64) size_t m_cachedHead = 0;       // 生产者私有
+    std::array<T, Capacity> m_buffer{};
+};
+
+class ChannelBase {
+public:
+    virtual ~ChannelBase() = default;
+    virtual bool ready() const = 0;
+    virtual void drain() = 0;
+};
+
+// 跨分片的边: 上游所在线程写入变化, 下游分片线程只取最新值写入本地副本
+template <typename Type>
+class Channel : public ChannelBase {
+public:
+    explicit Channel(std::shared_ptr<ReactImpl<Type>> replica) : m_replica(std::move(replica)) {}
+
+    void send(const Type &value) {
+        while (!m_queue.push(value)) {
+            std::this_thread::yield(); // 下游处理不过来时反压
+        }
+    }
+
+    bool ready() const override {
+        return !m_queue.empty();
+    }
+
+    void drain() override {
+        Type value;
+        bool changed = false;
+        while (m_queue.pop(value)) {
+            changed = true;
+        }
+        if (changed) {
+            m_replica->value(std::move(value)); // 同一轮中只传播最新值
+        }
+    }
+
+private:
+    SpscQueue<Type> m_queue;
+    std::shared_ptr<ReactImpl<Type>> m_replica;
+};
+
+// 图分片: 每个分片由一个(可绑核的)传播线程独占, 分片内单线程无锁求值,
+// 分片之间只通过connect()建立的SPSC通道传递变化. 使用约束:
+// - 分片内的结点和通道须在start()之前建好, 运行中connect()会抛异常; 运行期间不得对分片内的结点
+//   做reset/close或改变其依赖(包括自动追踪的calc读到新结点), 这些改动不加锁, 只能由构图线程在stop()之后进行
+// - 构图线程在分片运行时仍可创建, 拷贝和销毁与运行中分片无关的结点; 分片内结点的句柄在分片运行期间必须保持存活, 分片线程才能解引用
+// - 分片线程的传播不提交全局epoch(见PassGuard::detachEpoch), epoch只由构图/写线程推进.
+//   因此Versioned/ReadGuard快照只适用于在该线程上更新的结点, 不要为分片内的结点建立Versioned镜像
+class Shard {
+public:
+    Shard() = default;
+
+    ~Shard() {
+        stop();
+    }
+
+    Shard(const Shard &) = delete;
+    Shard &operator=(const Shard &) = delete;
+
+    // 把src接入本分片: 返回本分片中的副本var, 之后src的每次变化都经队列送达副本.
+    // src所在的线程(其他分片或外部线程)是该队列唯一的生产者
+    template <typename ReactType>
+    auto connect(const React<ReactType> &src) {
+        using Type = std::decay_t<typename ReactType::ValueType>;
+        if (m_running) {
+            REACTION_THROW(std::runtime_error("Cannot connect to a running shard."));
+        }
+        auto replica = var(Type(src.get()));
+        auto channel = std::make_shared<Channel<Type>>(replica.getPtr());
+        m_senders.push_back(observe(src, [channel](const Type &value) { channel->send(value); }, true));
+        m_inbound.push_back(channel);
+        return replica;
+    }
+
+    void start(int cpu = -1) {
+        if (m_running) {
+            return;
+        }
+        m_stop = false;
+        m_running = true;
+        m_thread = std::thread([this] { run(); });
+#if defined(__linux__)
+        if (cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(m_thread.native_handle(), sizeof(set), &set);
+        }
+#else
+        (void)cpu;
+#endif
+    }
+
+    void stop() {
+        if (!m_running) {
+            return;
+        }
+        m_stop = true;
+        m_thread.join();
+        m_running = false;
+    }
+
+private:
+    // 每次唤醒把所有就绪通道合并为一轮传播
+    void run() {
+        PassGuard::detachEpoch(); // epoch只有一个写者, 分片的传播不参与提交
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            if (std::ranges::none_of(m_inbound, [](const auto &c) { return c->ready(); })) {
+                std::this_thread::yield();
+                continue;
+            }
+            PassGuard pass;
+            for (auto &channel : m_inbound) {
+                channel->drain();
+            }
+            pass.finish();
+        }
+    }
+
+    std::vector<std::shared_ptr<ChannelBase>> m_inbound;
+    std::vector<NodePtr> m_senders;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+    bool m_running = false;
+};
+} // namespace reaction
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace reaction {
+// 跨进程发布: 共享内存区由定长槽位组成, 每个槽位用seqlock保护,
+// 写端是图中的镜像结点, 读端轮询序号, 全程只有内存读写, 没有系统调用
+struct ShmHeader {
+    static constexpr uint64_t Magic = 0x4d4853544345520a; // 小端字节序为"\nRECTSHM"
+    uint64_t magic;
+    uint32_t slotCount;
+    uint32_t slotSize; // 每个槽位负载的最大字节数
+};
+
+struct ShmSlot {
+    uint64_t seq; // 奇数表示正在写
+    uint32_t size;
+    uint32_t reserved;
+    // 之后紧跟slotSize字节的负载
+};
+
+template <typename T>
+concept ShmValue = std::is_trivially_copyable_v<T> && std::default_initializable<T>;
+
+class ShmRegion {
+public:
+    static constexpr size_t HeaderSize = 64;
+
+    // 创建(slotCount > 0)或打开(slotCount == 0)一个共享内存区
+    ShmRegion(const std::string &name, uint32_t slotCount, uint32_t slotSize) : m_name(name) {
+        bool create = slotCount > 0;
+        int fd = ::shm_open(name.c_str(), create ? O_CREAT | O_RDWR | O_TRUNC : O_RDWR, 0600);
+        if (fd < 0) {
+            REACTION_THROW(std::runtime_error("Failed to open shared memory: " + name));
+        }
+        if (create) {
+            m_length = HeaderSize + slotCount * stride(slotSize);
+            if (::ftruncate(fd, static_cast<off_t>(m_length)) != 0) {
+                ::close(fd);
+                REACTION_THROW(std::runtime_error("Failed to size shared memory: " + name));
+            }
+        } else {
+            struct stat st {};
+            ::fstat(fd, &st);
+            m_length = static_cast<size_t>(st.st_size);
+        }
+        void *base = m_length >= HeaderSize ? ::mmap(nullptr, m_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            REACTION_THROW(std::runtime_error("Failed to map shared memory: " + name));
+        }
+        m_base = static_cast<char *>(base);
+        if (create) {
+            header()->slotCount = slotCount;
+            header()->slotSize = slotSize;
+            std::atomic_ref<uint64_t>(header()->magic).store(ShmHeader::Magic, std::memory_order_release);
+        } else if (std::atomic_ref<uint64_t>(header()->magic).load(std::memory_order_acquire) != ShmHeader::Magic ||
+                   m_length < HeaderSize + header()->slotCount * stride(header()->slotSize)) {
+            ::munmap(m_base, m_length);
+            REACTION_THROW(std::runtime_error("Not a reaction shared memory region: " + name));
+        }
+    }
+
+    ~ShmRegion() {
+        ::munmap(m_base, m_length);
+    }
+
+    ShmRegion(const ShmRegion &) = delete;
+    ShmRegion &operator=(const ShmRegion &) = delete;
+
+    uint32_t slotCount() const {
+        return header()->slotCount;
+    }
+
+    uint32_t slotSize() const {
+        return header()->slotSize;
+    }
+
+    void unlink() {
+        ::shm_unlink(m_name.c_str());
+    }
+
+    void write(uint32_t index, const void *data, uint32_t size) {
+        auto s = slot(index);
+        std::atomic_ref<uint64_t> seq(s->seq);
+        uint64_t begin = seq.load(std::memory_order_relaxed) + 1;
+        seq.store(begin, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s->size = size;
+        std::memcpy(payload(s), data, size);
+        seq.store(begin + 1, std::memory_order_release);
+    }
+
+    // 读取一致的副本, 返回对应的序号; 写端正在写时自旋重试
+    uint64_t read(uint32_t index, void *data, uint32_t size) const {
+        auto s = slot(index);
+        std::atomic_ref<uint64_t> seq(s->seq);
+        for (;;) {
+            uint64_t begin = seq.load(std::memory_order_acquire);
+            if (begin & 1) {
+                continue;
+            }
+            std::memcpy(data, payload(s), std::min(size, s->size));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == begin) {
+                return begin;
+            }
+        }
+    }
+
+    uint64_t sequence(uint32_t index) const {
+        return std::atomic_ref<uint64_t>(slot(index)->seq).load(std::memory_order_acquire);
+    }
+
+private:
+    static size_t stride(uint32_t slotSize) {
+        return (sizeof(ShmSlot) + slotSize + 63) & ~size_t{63}; // 每个槽位独占缓存行
+    }
+
+    ShmHeader *header() const {
+        return reinterpret_cast<ShmHeader *>(m_base);
+    }
+
+    ShmSlot *slot(uint32_t index) const {
+        if (index >= header()->slotCount) {
+            REACTION_THROW(std::out_of_range("Shared memory slot out of range."));
+        }
+        return reinterpret_cast<ShmSlot *>(m_base + HeaderSize + index * stride(header()->slotSize));
+    }
+
+    static char *payload(ShmSlot *s) {
+        return reinterpret_cast<char *>(s) + sizeof(ShmSlot);
+    }
+
+    std::string m_name;
+    char *m_base = nullptr;
+    size_t m_length = 0;
+};
+
+// 发布端: 把选中结点的值镜像到共享内存槽位, 结点每次更新都会写入
+class ShmPublisher {
+public:
+    ShmPublisher(const std::string &name, uint32_t slotCount, uint32_t slotSize = 64) : m_region(name, slotCount, slotSize) {}
+
+    ~ShmPublisher() {
+        m_mirrors.clear();
+        m_region.unlink(); // 已映射的订阅端不受影响
+    }
+
+    template <typename ReactType>
+    void publish(const React<ReactType> &src, uint32_t slot) {
+        using Type = std::decay_t<typename ReactType::ValueType>;
+        static_assert(ShmValue<Type>, "Only trivially copyable values can be published to shared memory.");
+        if (sizeof(Type) > m_region.slotSize()) {
+            REACTION_THROW(std::runtime_error("Value does not fit into a shared memory slot."));
+        }
+        m_mirrors.push_back(observe(src, [this, slot](const Type &value) {
+            m_region.write(slot, &value, sizeof(Type));
+        }));
+    }
+
+private:
+    ShmRegion m_region;
+    std::vector<NodePtr> m_mirrors;
+};
+
+// 订阅端: 每个槽位对应本地图中的一个var源, poll()把有变化的槽位合并成一轮传播
+class ShmSubscriber {
+public:
+    explicit ShmSubscriber(const std::string &name) : m_region(name, 0, 0) {}
+
+    template <ShmValue T>
+    auto source(uint32_t slot) {
+        if (sizeof(T) > m_region.slotSize()) {
+            REACTION_THROW(std::runtime_error("Value does not fit into a shared memory slot."));
+        }
+        T value{};
+        uint64_t seq = m_region.read(slot, &value, sizeof(T));
+        auto src = var(value);
+        m_bindings.push_back({slot, seq, [this, slot, ptr = src.getPtr()](uint64_t &seq) {
+                                  T v{};
+                                  seq = m_region.read(slot, &v, sizeof(T));
+                                  ptr->value(v);
+                              }});
+        return src;
+    }
+
+    // 返回本次有更新的槽位数
+    size_t poll() {
+        size_t updated = 0;
+        PassGuard pass;
+        for (auto &binding : m_bindings) {
+            if (m_region.sequence(binding.slot) != binding.seq) {
+                binding.apply(binding.seq);
+                ++updated;
+            }
+        }
+        pass.finish();
+        return updated;
+    }
+
+private:
+    struct Binding {
+        uint32_t slot;
+        uint64_t seq; // 上次读到的序号
+        std::function<void(uint64_t &)> apply;
+    };
+
+    ShmRegion m_region;
+    std::vector<Binding> m_bindings;
+};
+} // namespace reaction
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "reaction/react.h"
+#include <array>
+
+namespace reaction {
+// 多版本快照读: 写线程每轮传播提交一个epoch, 读线程固定(pin)一个已提交的epoch,
+// 通过Versioned镜像读取该epoch时刻的一致切面, 全程无锁, 不阻塞写线程.
+// 写线程只有一个(拥有epoch的线程), 分片线程上更新的结点不能建立Versioned镜像
+
+class EpochManager {
+public:
+    static constexpr size_t MaxReaders = 64;
+
+    static EpochManager &getInstance() {
+        static EpochManager instance;
+        return instance;
+    }
+
+    // 占用一个读者槽位并固定当前已提交的epoch
+    size_t pin(uint64_t &epoch) {
+        auto &graph = ObserverGraph::getInstance();
+        for (size_t i = 0; i < MaxReaders; ++i) {
+            uint64_t expected = 0;
+            epoch = graph.epoch();
+            if (m_slots[i].pinned.compare_exchange_strong(expected, epoch)) {
+                // 写线程可能在读取epoch和登记之间提交并回收了旧版本, 重新确认直到稳定
+                while (graph.epoch() != epoch) {
+                    epoch = graph.epoch();
+                    m_slots[i].pinned.store(epoch);
+                }
+                return i;
+            }
+        }
+        REACTION_THROW(std::runtime_error("Too many concurrent snapshot readers."));
+    }
+
+    void unpin(size_t slot) {
+        m_slots[slot].pinned.store(0, std::memory_order_release);
+    }
+
+    // 写线程调用: 不再被任何读者需要的最老epoch, 每个epoch只扫描一次槽位
+    uint64_t safeEpoch() {
+        uint64_t committed = ObserverGraph::getInstance().epoch();
+        if (m_safeAt != committed) {
+            m_safe = committed;
+            for (auto &slot : m_slots) {
+                if (uint64_t pinned = slot.pinned.load(); pinned != 0) {
+                    m_safe = std::min(m_safe, pinned);
+                }
+            }
+            m_safeAt = committed;
+        }
+        return m_safe;
+    }
+
+private:
+    EpochManager() = default;
+
+    struct alignas(64) Slot { // 独占缓存行, 避免读者之间伪共享
+        std::atomic<uint64_t> pinned{0};
+    };
+
+    std::array<Slot, MaxReaders> m_slots{};
+    uint64_t m_safeAt = 0;
+    uint64_t m_safe = 0;
+};
+
+// 读者: 生命周期内固定一个epoch, 期间所有Versioned::read都读取同一切面
+class ReadGuard {
+public:
+    ReadGuard() : m_slot(EpochManager::getInstance().pin(m_epoch)) {}
+
+    ~ReadGuard() {
+        EpochManager::getInstance().unpin(m_slot);
+    }
+
+    ReadGuard(const ReadGuard &) = delete;
+    ReadGuard &operator=(const ReadGuard &) = delete;
+
+    uint64_t epoch() const {
+        return m_epoch;
+    }
+
+private:
+    uint64_t m_epoch = 0;
+    size_t m_slot;
+};
+
+// 按epoch从新到旧排列的版本链, 只有写线程修改
+template <typename Type>
+class VersionChain {
+public:
+    VersionChain() = default;
+    VersionChain(const VersionChain &) = delete;
+    VersionChain &operator=(const VersionChain &) = delete;
+
+    ~VersionChain() {
+        release(m_head.load(std::memory_order_relaxed));
+    }
+
+    void publish(const Type &value) {
+        uint64_t epoch = ObserverGraph::getInstance().epoch() + 1;
+        auto head = m_head.load(std::memory_order_relaxed);
+        m_head.store(new Version{value, epoch, head}, std::memory_order_release);
+        trim(EpochManager::getInstance().safeEpoch());
+    }
+
+    const Type &read(uint64_t epoch) const {
+        auto version = m_head.load(std::memory_order_acquire);
+        while (version && version->epoch > epoch) {
+            version = version->next.load(std::memory_order_acquire);
+        }
+        if (!version) {
+            REACTION_THROW(std::runtime_error("No version visible at this epoch."));
+        }
+        return version->value;
+    }
+
+    size_t versionCount() const {
+        size_t count = 0;
+        for (auto v = m_head.load(std::memory_order_acquire); v; v = v->next.load(std::memory_order_acquire)) {
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    struct Version {
+        Type value;
+        uint64_t epoch;
+        std::atomic<Version *> next;
+    };
+
+    // 保留epoch不超过safe的最新版本, 更老的版本没有读者能访问到, 直接回收
+    void trim(uint64_t safe) {
+        auto version = m_head.load(std::memory_order_relaxed);
+        while (version && version->epoch > safe) {
+            version = version->next.load(std::memory_order_relaxed);
+        }
+        if (version) {
+            release(version->next.exchange(nullptr, std::memory_order_relaxed));
+        }
+    }
+
+    static void release(Version *version) {
+        while (version) {
+            auto next = version->next.load(std::memory_order_relaxed);
+            delete version;
+            version = next;
+        }
+    }
+
+    std::atomic<Version *> m_head{nullptr};
+};
+
+// 某个结点的版本化镜像: 该结点每次更新都发布一个带epoch的只读副本
+template <typename Type>
+class Versioned {
+public:
+    template <typename ReactType>
+    explicit Versioned(const React<ReactType> &src) : m_chain(std::make_shared<VersionChain<Type>>()) {
+        PassGuard pass; // 初始版本随本轮提交后对读者可见
+        m_mirror = observe(src, [chain = m_chain](const Type &value) { chain->publish(value); }); // 镜像随Versioned一起回收
+        pass.finish();
+    }
+
+    const Type &read(const ReadGuard &guard) const {
+        return m_chain->read(guard.epoch());
+    }
+
+    size_t versionCount() const {
+        return m_chain->versionCount();
+    }
+
+private:
+    std::shared_ptr<VersionChain<Type>> m_chain;
+    NodePtr m_mirror;
+};
+
+template <typename ReactType>
+auto versioned(const React<ReactType> &src) {
+    return Versioned<std::decay_t<typename ReactType::ValueType>>(src);
+}
+} // namespace reaction
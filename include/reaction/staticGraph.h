@@ -0,0 +1,181 @@
+#pragma once
+
+#include "reaction/expression.h"
+#include <array>
+#include <tuple>
+
+namespace reaction {
+// 编译期静态图: 结点用类型描述, 拓扑序和传播路径都在编译期确定,
+// 所有值保存在同一个tuple中, 传播被展开为直线代码, 没有堆分配和虚调用
+template <typename Tag, typename Type>
+struct StaticVar {
+    using TagType = Tag;
+};
+
+template <typename Tag, typename Fun, typename... Deps>
+    requires std::default_initializable<Fun> // 函数对象无状态, 求值时直接构造
+struct StaticCalc {
+    using TagType = Tag;
+};
+
+template <typename Tag, typename Fun, typename... Deps>
+using StaticAction = StaticCalc<Tag, Fun, Deps...>;
+
+template <typename Tag, typename... Nodes>
+consteval size_t staticIndexOf() {
+    constexpr std::array<bool, sizeof...(Nodes)> match{std::is_same_v<Tag, typename Nodes::TagType>...};
+    for (size_t i = 0; i < match.size(); ++i) {
+        if (match[i]) return i;
+    }
+    return sizeof...(Nodes);
+}
+
+template <typename Node, typename... Nodes>
+struct StaticNodeTraits;
+
+template <typename Tag, typename Type, typename... Nodes>
+struct StaticNodeTraits<StaticVar<Tag, Type>, Nodes...> {
+    using type = Type;
+    static constexpr bool isVar = true;
+
+    static constexpr std::array<bool, sizeof...(Nodes)> dependencies() {
+        return {};
+    }
+};
+
+template <typename Tag, typename Fun, typename... Deps, typename... Nodes>
+struct StaticNodeTraits<StaticCalc<Tag, Fun, Deps...>, Nodes...> {
+    static_assert(((staticIndexOf<Deps, Nodes...>() < sizeof...(Nodes)) && ...), "StaticCalc depends on an unknown tag.");
+
+    template <typename D>
+    using DepType = typename StaticNodeTraits<std::tuple_element_t<staticIndexOf<D, Nodes...>(), std::tuple<Nodes...>>, Nodes...>::type;
+
+    // 与ExpressionTraits一致: 参数类型递归萃取, void结果用VoidWrapper代替
+    using rawType = std::invoke_result_t<Fun &, const DepType<Deps> &...>;
+    using type = std::conditional_t<VoidType<rawType>, VoidWrapper, rawType>;
+    static constexpr bool isVar = false;
+
+    static constexpr std::array<bool, sizeof...(Nodes)> dependencies() {
+        std::array<bool, sizeof...(Nodes)> row{};
+        ((row[staticIndexOf<Deps, Nodes...>()] = true), ...);
+        return row;
+    }
+};
+
+// Kahn算法, 编译期求拓扑序(adj[i][j]: i依赖j); 返回的序列长度不足N说明存在环
+template <size_t N>
+constexpr std::pair<std::array<size_t, N>, size_t> staticTopologicalOrder(const std::array<std::array<bool, N>, N> &adj) {
+    std::array<size_t, N> order{};
+    std::array<size_t, N> indegree{};
+    for (size_t i = 0; i < N; ++i) {
+        for (size_t j = 0; j < N; ++j) {
+            indegree[i] += adj[i][j];
+        }
+    }
+    size_t head = 0, tail = 0;
+    for (size_t i = 0; i < N; ++i) {
+        if (indegree[i] == 0) order[tail++] = i;
+    }
+    while (head < tail) {
+        size_t u = order[head++];
+        for (size_t v = 0; v < N; ++v) {
+            if (adj[v][u] && --indegree[v] == 0) order[tail++] = v;
+        }
+    }
+    return {order, tail};
+}
+
+// 按拓扑序标记受sources影响的下游结点
+template <size_t N>
+constexpr std::array<bool, N> staticAffected(const std::array<std::array<bool, N>, N> &adj, const std::array<size_t, N> &order, std::array<bool, N> mask) {
+    for (size_t k = 0; k < N; ++k) {
+        size_t i = order[k];
+        for (size_t j = 0; j < N && !mask[i]; ++j) {
+            mask[i] = adj[i][j] && mask[j];
+        }
+    }
+    return mask;
+}
+
+template <typename... Nodes>
+class StaticGraph {
+    static constexpr size_t N = sizeof...(Nodes);
+    using Mask = std::array<bool, N>;
+
+    static constexpr std::array<std::array<bool, N>, N> s_adj{StaticNodeTraits<Nodes, Nodes...>::dependencies()...};
+    static constexpr auto s_sorted = staticTopologicalOrder<N>(s_adj);
+    static_assert(s_sorted.second == N, "StaticGraph contains a dependency cycle.");
+    static constexpr std::array<size_t, N> s_order = s_sorted.first;
+
+    template <typename... Tags>
+    static constexpr Mask s_affected = staticAffected<N>(s_adj, s_order, [] {
+        Mask mask{};
+        ((mask[staticIndexOf<Tags, Nodes...>()] = true), ...);
+        return mask;
+    }());
+
+    static constexpr Mask s_all = [] {
+        Mask mask{};
+        mask.fill(true);
+        return mask;
+    }();
+
+public:
+    template <typename Tag>
+    static constexpr size_t indexOf = staticIndexOf<Tag, Nodes...>();
+
+    template <typename Tag>
+        requires(indexOf<Tag> < N)
+    using ValueType = typename StaticNodeTraits<std::tuple_element_t<indexOf<Tag>, std::tuple<Nodes...>>, Nodes...>::type;
+
+    StaticGraph() {
+        propagate<s_all>();
+    }
+
+    template <typename Tag>
+    const ValueType<Tag> &get() const {
+        return std::get<indexOf<Tag>>(m_values);
+    }
+
+    template <typename Tag, typename T>
+    void set(T &&t) {
+        update<Tag>(std::forward<T>(t));
+    }
+
+    // 同时更新多个源, 受影响的下游按拓扑序各求值一次
+    template <typename... Tags, typename... T>
+        requires(sizeof...(Tags) == sizeof...(T) && sizeof...(Tags) > 0)
+    void update(T &&...values) {
+        static_assert((StaticNodeTraits<std::tuple_element_t<indexOf<Tags>, std::tuple<Nodes...>>, Nodes...>::isVar && ...), "Only StaticVar nodes can be updated.");
+        ((std::get<indexOf<Tags>>(m_values) = std::forward<T>(values)), ...);
+        propagate<s_affected<Tags...>>();
+    }
+
+private:
+    template <const Mask &mask>
+    void propagate() {
+        [this]<size_t... K>(std::index_sequence<K...>) {
+            (evaluate<s_order[K], mask[s_order[K]]>(), ...);
+        }(std::make_index_sequence<N>{});
+    }
+
+    template <size_t I, bool affected>
+    void evaluate() {
+        using Node = std::tuple_element_t<I, std::tuple<Nodes...>>;
+        if constexpr (affected && !StaticNodeTraits<Node, Nodes...>::isVar) {
+            evaluate(std::type_identity<Node>{});
+        }
+    }
+
+    template <typename Tag, typename Fun, typename... Deps>
+    void evaluate(std::type_identity<StaticCalc<Tag, Fun, Deps...>>) {
+        if constexpr (VoidType<ValueType<Tag>>) {
+            std::invoke(Fun{}, get<Deps>()...);
+        } else {
+            std::get<indexOf<Tag>>(m_values) = std::invoke(Fun{}, get<Deps>()...);
+        }
+    }
+
+    std::tuple<typename StaticNodeTraits<Nodes, Nodes...>::type...> m_values;
+};
+} // namespace reaction
@@ -0,0 +1,28 @@
+// 分配计数测试: 与countingNew.cpp一起单独构建成allocationTests, 主测试程序使用默认的operator new
+#include "reaction/memory.h"
+#include "reaction/shard.h"
+#include "gtest/gtest.h"
+
+TEST(AllocationTest, TestSteadyStateUpdates) {
+    auto x = reaction::var(1);
+    auto y = reaction::calc([](int v) { return v * 2; }, x);
+    auto z = reaction::calc([&]() { return y() + 1; });
+    x.value(2); // 预热调度队列
+    reaction::AllocationCounter counter;
+    for (int i = 0; i < 100; ++i) {
+        x.value(i);
+    }
+    EXPECT_EQ(counter.allocations(), 0u); // 稳态更新不分配内存
+    EXPECT_EQ(z.get(), 99 * 2 + 1);
+}
+
+TEST(AllocationTest, TestCounterSeesAllocations) {
+    reaction::AllocationCounter probe;
+    auto w = reaction::var(std::vector<int>(16));
+    EXPECT_GT(probe.allocations(), 0u);
+
+    reaction::AllocationCounter aligned;
+    auto queue = std::make_unique<reaction::SpscQueue<int, 4>>(); // 按缓存行对齐, 走align_val_t重载
+    EXPECT_EQ(aligned.allocations(), 1u);
+    EXPECT_GE(aligned.bytes(), sizeof(*queue));
+}
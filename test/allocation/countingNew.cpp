@@ -0,0 +1,68 @@
+// 替换全局operator new/delete, 把当前线程的分配次数和字节数记入reaction::allocationStats().
+// 只能链接进一个需要计数的程序, 不要和其他替换operator new的代码一起使用
+#include "reaction/memory.h"
+#include <cstdlib>
+#include <new>
+
+void *operator new(std::size_t size) {
+    auto &stats = reaction::allocationStats();
+    ++stats.allocations;
+    stats.bytes += size;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    REACTION_THROW(std::bad_alloc());
+}
+
+void *operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// 超对齐类型(如按缓存行对齐的队列)走align_val_t重载, 同样计数; aligned_alloc要求大小是对齐值的整数倍
+void *operator new(std::size_t size, std::align_val_t align) {
+    auto &stats = reaction::allocationStats();
+    ++stats.allocations;
+    stats.bytes += size;
+    auto alignment = static_cast<std::size_t>(align);
+    std::size_t rounded = size ? (size + alignment - 1) / alignment * alignment : alignment;
+    if (void *p = std::aligned_alloc(alignment, rounded)) {
+        return p;
+    }
+    REACTION_THROW(std::bad_alloc());
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+    return ::operator new(size, align);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
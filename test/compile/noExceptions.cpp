@@ -0,0 +1,34 @@
+// 编译检查: 所有头文件都能在-fno-exceptions下编译, 只编译不链接进测试程序
+#include "reaction/builder.h"
+#include "reaction/bulk.h"
+#include "reaction/eventLoop.h"
+#include "reaction/gate.h"
+#include "reaction/journal.h"
+#include "reaction/memo.h"
+#include "reaction/memory.h"
+#include "reaction/react.h"
+#include "reaction/shard.h"
+#include "reaction/sharedMemory.h"
+#include "reaction/snapshot.h"
+#include "reaction/staticGraph.h"
+
+#if REACTION_EXCEPTIONS
+#error "This translation unit must be compiled with -fno-exceptions."
+#endif
+
+// 实例化传播路径上的模板, 只有被实例化的代码才会真正检查throw/try
+void reactionNoExceptionsCheck() {
+    auto a = reaction::var(1);
+    auto b = reaction::calc([](int x) { return x * 2; }, a);
+    auto c = reaction::tryCalc([](int x) { return x + 1; }, b);
+    auto gated = reaction::filter([](int x) { return x > 0; }, b);
+    reaction::Versioned<int> mirror(b);
+    auto lanes = reaction::bulkVar<int>(4, 1);
+    auto scaled = reaction::bulkCalc([](int x) { return x * 10; }, lanes);
+    reaction::batch([&] { a.value(2); });
+    reaction::ReadGuard guard;
+    (void)mirror.read(guard);
+    (void)c.get();
+    (void)gated.get();
+    (void)scaled.get();
+}
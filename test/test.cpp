@@ -1,7 +1,20 @@
+#include "reaction/builder.h"
+#include "reaction/bulk.h"
+#include "reaction/eventLoop.h"
+#include "reaction/gate.h"
+#include "reaction/journal.h"
+#include "reaction/memo.h"
+#include "reaction/memory.h"
 #include "reaction/react.h"
+#include "reaction/shard.h"
+#include "reaction/sharedMemory.h"
+#include "reaction/snapshot.h"
+#include "reaction/staticGraph.h"
 #include "gtest/gtest.h"
 #include <chrono>
 #include <numeric>
+#include <optional>
+#include <thread>
 
 TEST(ReactionTest, TestCommonUse) {
     auto a = reaction::var(1);
@@ -129,6 +142,92 @@ TEST(ReactionTest, TestReset) {
     EXPECT_EQ(dds.get(), 6);
 }
 
+TEST(ReactionTest, TestResetDropsOldEdges) {
+    auto a = reaction::var(1);
+    auto b = reaction::var(2);
+    int count = 0;
+    auto ds = reaction::calc([&](auto aa, auto bb) { ++count; return aa + bb; }, a, b);
+
+    ds.reset([&](auto aa) { ++count; return aa * 10; }, a);
+    count = 0;
+    b.value(5);
+    EXPECT_EQ(count, 0);
+    a.value(3);
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(ds.get(), 30);
+}
+
+TEST(ReactionTest, TestResetRollback) {
+    auto flag = reaction::var(false);
+    auto a = reaction::var(1);
+    auto b = reaction::var(10);
+    auto ds = reaction::calc([&]() { return flag() ? a() : b(); });
+    auto dd = reaction::calc([](int v) { return v; }, ds);
+    EXPECT_THROW(ds.reset([](int v) { return v; }, dd), std::runtime_error);
+    b.value(20); // 仍然是自动追踪
+    EXPECT_EQ(ds.get(), 20);
+    flag.value(true);
+    EXPECT_EQ(ds.get(), 1);
+
+    auto c = reaction::var(0);
+    auto e = reaction::calc([](int v) { return v * 2; }, a);
+    EXPECT_THROW(e.reset([](int v) -> int { if (v == 0) throw std::runtime_error("zero"); return v; }, c), std::runtime_error);
+    a.value(7); // 旧函数和旧依赖一起恢复
+    EXPECT_EQ(e.get(), 14);
+    c.value(3);
+    EXPECT_EQ(e.get(), 14);
+}
+
+TEST(ReactionTest, TestDynamicDependency) {
+    auto flag = reaction::var(true);
+    auto a = reaction::var(1);
+    auto b = reaction::var(2);
+    int count = 0;
+    auto ds = reaction::calc([&]() { ++count; return flag() ? a() : b(); });
+    EXPECT_EQ(ds.get(), 1);
+
+    count = 0;
+    b.value(3); // b尚未被读取, 不应触发
+    EXPECT_EQ(count, 0);
+
+    flag.value(false);
+    EXPECT_EQ(ds.get(), 3);
+    count = 0;
+    a.value(4); // a已不再被读取, 旧边应被删除
+    EXPECT_EQ(count, 0);
+    b.value(5);
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(ds.get(), 5);
+}
+
+TEST(ReactionTest, TestNodeLifetime) {
+    auto &graph = reaction::ObserverGraph::getInstance();
+    auto a = reaction::var(1);
+    auto base = graph.size();
+    int count = 0;
+    {
+        auto ds = reaction::calc([&](int aa) { ++count; return aa + 1; }, a);
+        auto dds = reaction::calc([&]() { ++count; return ds() * 2; });
+        EXPECT_EQ(graph.size(), base + 2);
+    }
+    EXPECT_EQ(graph.size(), base); // 句柄释放后整条子图被回收
+    count = 0;
+    a.value(2);
+    EXPECT_EQ(count, 0); // 死结点不再参与传播
+
+    std::weak_ptr<reaction::ObserverNode> weakDs;
+    auto dds = [&]() {
+        auto ds = reaction::calc([](int aa) { return aa + 1; }, a);
+        weakDs = ds.getPtr();
+        return reaction::calc([](int dsds) { return dsds * 2; }, ds);
+    }();
+    EXPECT_FALSE(weakDs.expired()); // 仍被观察的结点由下游保活
+    a.value(3);
+    EXPECT_EQ(dds.get(), 8);
+    dds = decltype(dds){};
+    EXPECT_TRUE(weakDs.expired()); // 最后一个观察者释放时回收
+}
+
 TEST(ReactionTest, TestParentheses) {
     auto a = reaction::var(1);
     auto b = reaction::var(3.14);
@@ -163,6 +262,9 @@ TEST(ReactionTest, TestSelfDependency) {
     auto dsA = reaction::calc([](int aa) { return aa; }, a);
 
     EXPECT_THROW(dsA.reset([&]() { return a() + dsA(); }), std::runtime_error);
+    EXPECT_EQ(dsA.get(), 1); // 失败的reset不应修改值和依赖
+    a.value(2);
+    EXPECT_EQ(dsA.get(), 2);
 }
 
 TEST(ReactionTest, TestCycleDependency) {
@@ -183,6 +285,696 @@ TEST(ReactionTest, TestCycleDependency) {
     EXPECT_THROW(dsC.reset([&]() { return a() - dsA(); }), std::runtime_error);
 }
 
+struct StaticGraphCount {
+    static inline int evaluations = 0;
+};
+
+TEST(ReactionTest, TestStaticGraph) {
+    struct A;
+    struct B;
+    struct Sum;
+    struct Twice;
+    struct Str;
+    StaticGraphCount::evaluations = 0; // 每次运行都重置, 支持--gtest_repeat
+    using Graph = reaction::StaticGraph<
+        // 结点声明顺序任意, 拓扑序在编译期计算
+        reaction::StaticCalc<Str, decltype([](int tt) { ++StaticGraphCount::evaluations; return std::to_string(tt); }), Twice>,
+        reaction::StaticCalc<Twice, decltype([](double ss) { return static_cast<int>(ss * 2); }), Sum>,
+        reaction::StaticCalc<Sum, reaction::addOp, A, B>,
+        reaction::StaticVar<A, int>,
+        reaction::StaticVar<B, double>>;
+
+    Graph g;
+    EXPECT_EQ(g.get<Str>(), "0");
+    g.update<A, B>(1, 1.5);
+    EXPECT_EQ(g.get<Sum>(), 2.5);
+    EXPECT_EQ(g.get<Str>(), "5");
+    EXPECT_EQ(StaticGraphCount::evaluations, 2);
+
+    g.set<A>(2);
+    EXPECT_EQ(g.get<Twice>(), 7);
+    EXPECT_EQ(g.get<Str>(), "7");
+    EXPECT_EQ(StaticGraphCount::evaluations, 3);
+}
+
+TEST(ReactionTest, TestBulkNode) {
+    const size_t n = 200;
+    auto price = reaction::bulkVar<double>(n, 1.0);
+    auto qty = reaction::bulkVar<int>(n, 2);
+    int count = 0;
+    auto notional = reaction::bulkCalc([&](double p, int q) { ++count; return p * q; }, price, qty);
+
+    EXPECT_EQ(notional.get().size(), n);
+    EXPECT_EQ(notional.get()[199], 2.0);
+    EXPECT_EQ(count, static_cast<int>(n));
+
+    count = 0;
+    reaction::bulkUpdate(price, [](auto &lanes) {
+        lanes.set(3, 2.5);
+        lanes.set(130, 4.0);
+    });
+    EXPECT_EQ(count, 2); // 只计算脏lane
+    EXPECT_EQ(notional.get()[3], 5.0);
+    EXPECT_EQ(notional.get()[130], 8.0);
+    EXPECT_TRUE(notional.get().isDirty(130));
+    EXPECT_FALSE(notional.get().isDirty(4));
+    EXPECT_EQ(notional.get().dirtyCount(), 2u);
+
+    count = 0;
+    reaction::bulkUpdate(qty, [](auto &lanes) {
+        for (size_t i = 0; i < 64; ++i) lanes.set(i, 3);
+    });
+    EXPECT_EQ(count, 64);
+    EXPECT_EQ(notional.get()[3], 7.5);
+    EXPECT_EQ(notional.get()[130], 8.0);
+}
+
+TEST(ReactionTest, TestBulkBatchUpdates) {
+    auto a = reaction::bulkVar<int>(4, 1);
+    auto b = reaction::bulkVar<int>(4, 10);
+    auto c = reaction::bulkCalc([](int x, int y) { return x * y; }, a, b);
+    EXPECT_EQ(c.get()[0], 10);
+
+    reaction::batch([&] {
+        reaction::bulkUpdate(a, [](auto &lanes) { lanes.set(0, 11); });
+        reaction::bulkUpdate(b, [](auto &lanes) { lanes.set(1, 20); });
+        reaction::bulkUpdate(a, [](auto &lanes) { lanes.set(3, 2); }); // 同一轮的第二次更新不丢掉前一次的脏位
+    });
+    EXPECT_EQ(c.get()[0], 110);
+    EXPECT_EQ(c.get()[1], 20);
+    EXPECT_EQ(c.get()[3], 20);
+    EXPECT_EQ(c.get().dirtyCount(), 3u);
+
+    a.value(reaction::Lanes<int>(4, 7)); // 整体替换时所有lane都重新计算
+    EXPECT_EQ(c.get()[2], 70);
+    EXPECT_EQ(c.get()[1], 140);
+
+    reaction::bulkUpdate(b, [](auto &lanes) { lanes.set(2, 1); });
+    EXPECT_EQ(c.get()[2], 7);
+    EXPECT_EQ(c.get().dirtyCount(), 1u);
+}
+
+TEST(ReactionTest, TestBulkAcrossPasses) {
+    auto a = reaction::bulkVar<int>(100, 1);
+    int count = 0;
+    auto scaled = reaction::bulkCalc([&count](int x) { ++count; return x * 10; }, a);
+    auto shifted = reaction::bulkCalc([](int x) { return x + 1; }, scaled);
+    scaled.setPriority(reaction::Priority::Idle);
+    shifted.setPriority(reaction::Priority::Idle); // 下游也是Idle, scaled的实际优先级才是Idle
+
+    count = 0;
+    reaction::bulkUpdate(a, [](auto &lanes) { lanes.set(0, 2); });
+    reaction::bulkUpdate(a, [](auto &lanes) { lanes.set(70, 3); }); // 另一轮传播, 脏位已清空
+    EXPECT_EQ(scaled.get()[0], 10);
+    EXPECT_TRUE(reaction::runIdle());
+    EXPECT_EQ(count, 2); // 错过的两轮改动都被合并进来, 且只计算改动过的lane
+    EXPECT_EQ(scaled.get()[0], 20);
+    EXPECT_EQ(scaled.get()[70], 30);
+    EXPECT_EQ(shifted.get()[0], 21);
+    EXPECT_EQ(shifted.get()[70], 31);
+
+    auto copy = a.get(); // 拷贝后整体写回: 来源变化, 所有lane重新计算
+    copy.set(5, 4);
+    a.value(copy);
+    EXPECT_TRUE(reaction::runIdle());
+    EXPECT_EQ(count, 2 + 100);
+    EXPECT_EQ(scaled.get()[5], 40);
+}
+
+struct CopyCounter {
+    static inline int copies = 0;
+    std::string payload;
+
+    CopyCounter(std::string p = {}) : payload(std::move(p)) {}
+    CopyCounter(const CopyCounter &other) : payload(other.payload) { ++copies; }
+    CopyCounter(CopyCounter &&) = default;
+    CopyCounter &operator=(const CopyCounter &other) {
+        payload = other.payload;
+        ++copies;
+        return *this;
+    }
+    CopyCounter &operator=(CopyCounter &&) = default;
+};
+
+TEST(ReactionTest, TestZeroCopy) {
+    CopyCounter::copies = 0;
+    auto src = reaction::var(CopyCounter{"abc"});
+    auto len = reaction::calc([](const CopyCounter &c) { return c.payload.size(); }, src);
+    auto view = reaction::calc([](std::string_view s) { return s.substr(1).size(); },
+        reaction::calc([](const CopyCounter &c) { return c.payload; }, src));
+    src.value(CopyCounter{"abcdef"});
+    EXPECT_EQ(len.get(), 6u);
+    EXPECT_EQ(view.get(), 5u);
+    EXPECT_EQ(CopyCounter::copies, 0);
+
+    auto vec = reaction::var(std::vector<int>{1, 2, 3});
+    auto sum = reaction::calc([](std::span<const int> v) { return std::accumulate(v.begin(), v.end(), 0); }, vec);
+    EXPECT_EQ(sum.get(), 6);
+}
+
+TEST(ReactionTest, TestInPlaceCalc) {
+    auto base = reaction::var(1.5);
+    int count = 0;
+    auto text = reaction::calc(reaction::inPlace<std::string>([&](std::string &out, double v) {
+        ++count;
+        out.assign("Value:");
+        out += std::to_string(v);
+    }),
+        base);
+    EXPECT_EQ(text.get(), "Value:1.500000");
+    EXPECT_EQ(count, 1);
+
+    base.value(100000.25); // 先把缓冲区撑大
+    const char *buffer = text.get().data();
+    base.value(2.5);
+    EXPECT_EQ(text.get(), "Value:2.500000");
+    EXPECT_EQ(text.get().data(), buffer); // 复用了已有容量
+    EXPECT_EQ(count, 3);
+}
+
+TEST(ReactionTest, TestSnapshotRead) {
+    auto a = reaction::var(1);
+    auto b = reaction::calc([](int aa) { return aa * 10; }, a);
+    auto snapA = reaction::versioned(a);
+    auto snapB = reaction::versioned(b);
+
+    {
+        reaction::ReadGuard guard;
+        a.value(2); // 读者固定的epoch看不到本轮更新
+        EXPECT_EQ(snapA.read(guard), 1);
+        EXPECT_EQ(snapB.read(guard), 10);
+        EXPECT_EQ(a.get(), 2);
+    }
+    {
+        reaction::ReadGuard guard;
+        EXPECT_EQ(snapA.read(guard), 2);
+        EXPECT_EQ(snapB.read(guard), 20);
+    }
+    a.value(3);
+    EXPECT_LE(snapA.versionCount(), 2u); // 没有读者时旧版本被及时回收
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> inconsistent{0};
+    std::thread reader([&] {
+        while (!stop.load()) {
+            reaction::ReadGuard guard;
+            if (snapB.read(guard) != snapA.read(guard) * 10) {
+                ++inconsistent;
+            }
+        }
+    });
+    for (int i = 0; i < 20000; ++i) {
+        a.value(i);
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(inconsistent.load(), 0);
+}
+
+TEST(ReactionTest, TestBatchGlitchFree) {
+    auto a = reaction::var(1);
+    auto b = reaction::var(2);
+    auto left = reaction::calc([](int aa) { return aa * 2; }, a);
+    auto right = reaction::calc([](int aa, int bb) { return aa + bb; }, a, b);
+    int count = 0;
+    std::vector<int> seen;
+    auto sum = reaction::calc([&](int l, int r) { ++count; seen.push_back(l + r); return l + r; }, left, right);
+
+    count = 0;
+    seen.clear();
+    a.value(2); // 菱形依赖: sum只在left和right都更新后求值一次
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(seen, std::vector<int>{8});
+
+    count = 0;
+    reaction::batch([&] {
+        a.value(3);
+        b.value(4);
+        a.value(5);
+    });
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(sum.get(), 19);
+}
+
+TEST(ReactionTest, TestSchedulerDropsQueuedNode) {
+    auto a = reaction::var(1);
+    int count = 0;
+    auto make = [&] { return reaction::calc([&count](int v) { ++count; return v; }, a); };
+    std::optional<decltype(make())> victim(make());
+    victim->setPriority(reaction::Priority::Low); // 排在action之后求值
+    auto killer = reaction::action([&](int v) { if (v == 2) victim.reset(); }, a);
+    count = 0;
+    a.value(2); // 已入队的结点在本轮中被释放, 不能再被求值
+    EXPECT_FALSE(victim.has_value());
+    EXPECT_EQ(count, 0);
+    a.value(3);
+    EXPECT_EQ(count, 0);
+}
+
+TEST(ReactionTest, TestObserve) {
+    auto a = reaction::var(1);
+    std::vector<int> seen;
+    auto all = reaction::observe(a, [&](int v) { seen.push_back(v); });
+    auto later = reaction::observe(a, [&](int v) { seen.push_back(-v); }, true);
+    EXPECT_EQ(seen, (std::vector<int>{1}));
+    a.value(2);
+    EXPECT_EQ(seen.size(), 3u);
+    later.reset(); // 释放即取消观察
+    a.value(3);
+    EXPECT_EQ(seen.back(), 3);
+    EXPECT_EQ(seen.size(), 4u);
+}
+
+TEST(ReactionTest, TestJournalReplay) {
+    std::string path = testing::TempDir() + "reaction_journal.log";
+    auto build = [](auto &price, auto &name, int &count) {
+        return reaction::calc([&count](double p, const std::string &n) { ++count; return n + ":" + std::to_string(p); }, price, name);
+    };
+
+    std::string expected;
+    {
+        auto price = reaction::var(1.0);
+        auto name = reaction::var(std::string{"AAPL"});
+        int count = 0;
+        auto quote = build(price, name, count);
+        reaction::Journal journal(path, 64); // 初始容量很小, 覆盖扩容路径
+        journal.record(price, 0);
+        journal.record(name, 1);
+        for (int i = 0; i < 100; ++i) {
+            price.value(i * 0.5);
+        }
+        name.value(std::string{"MSFT"});
+        price.value(42.0);
+        EXPECT_EQ(journal.count(), 102u);
+        reaction::batch([&] { // 同一轮中的每次写入都单独记录
+            price.value(1.0);
+            name.value(std::string{"IBM"});
+            price.value(2.0);
+        });
+        EXPECT_EQ(journal.count(), 105u);
+        expected = quote.get();
+    }
+
+    {
+        auto price = reaction::var(1.0);
+        auto name = reaction::var(std::string{"AAPL"});
+        int count = 0;
+        auto quote = build(price, name, count);
+        reaction::Replayer replayer(path);
+        replayer.bind(0, price);
+        replayer.bind(1, name);
+        count = 0;
+        EXPECT_EQ(replayer.run(), 105u);
+        EXPECT_EQ(count, 105);
+        EXPECT_EQ(quote.get(), expected);
+    }
+
+    {
+        auto price = reaction::var(1.0);
+        auto name = reaction::var(std::string{"AAPL"});
+        int count = 0;
+        auto quote = build(price, name, count);
+        reaction::Replayer replayer(path);
+        replayer.bind(0, price);
+        replayer.bind(1, name);
+        count = 0;
+        EXPECT_EQ(replayer.run(50), 105u); // 每50条合并为一轮传播
+        EXPECT_EQ(count, 3);
+        EXPECT_EQ(quote.get(), expected);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(ReactionTest, TestSharedMemoryPublish) {
+    struct Quote {
+        double bid;
+        double ask;
+    };
+    std::string name = "/reaction_test_" + std::to_string(::getpid());
+    auto bid = reaction::var(1.0);
+    auto quote = reaction::calc([](double b) { return Quote{b, b + 0.5}; }, bid);
+
+    reaction::ShmPublisher publisher(name, 4);
+    publisher.publish(bid, 0);
+    publisher.publish(quote, 1);
+
+    reaction::ShmSubscriber subscriber(name); // 模拟另一个进程: 独立映射同一块共享内存
+    auto remoteBid = subscriber.source<double>(0);
+    auto remoteQuote = subscriber.source<Quote>(1);
+    auto spread = reaction::calc([](const Quote &q) { return q.ask - q.bid; }, remoteQuote);
+    EXPECT_EQ(remoteBid.get(), 1.0);
+    EXPECT_EQ(remoteQuote.get().ask, 1.5);
+
+    EXPECT_EQ(subscriber.poll(), 0u);
+    bid.value(2.0);
+    EXPECT_EQ(remoteBid.get(), 1.0); // 订阅端只在poll时更新
+    EXPECT_EQ(subscriber.poll(), 2u);
+    EXPECT_EQ(remoteBid.get(), 2.0);
+    EXPECT_EQ(remoteQuote.get().bid, 2.0);
+    EXPECT_EQ(spread.get(), 0.5);
+}
+
+TEST(ReactionTest, TestMemoCalc) {
+    auto regime = reaction::var(0);
+    auto bucket = reaction::var(std::string{"low"});
+    int count = 0;
+    auto model = reaction::memoCalc<2>([&](int r, const std::string &b) { ++count; return b + std::to_string(r); }, regime, bucket);
+    EXPECT_EQ(model.get(), "low0");
+
+    regime.value(1);
+    regime.value(0); // 命中缓存
+    regime.value(1);
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(model.get(), "low1");
+
+    bucket.value(std::string{"high"}); // 容量为2, 淘汰一个条目
+    EXPECT_EQ(model.get(), "high1");
+    EXPECT_EQ(count, 3);
+    regime.value(0);
+    regime.value(1);
+    EXPECT_EQ(model.get(), "high1");
+    EXPECT_EQ(count, 4);
+}
+
+TEST(ReactionTest, TestShardPropagation) {
+    reaction::Shard first;
+    reaction::Shard second;
+    std::atomic<int> result{0};
+
+    auto tick = reaction::var(0);
+    auto inFirst = first.connect(tick);
+    auto doubled = reaction::calc([](int t) { return t * 2; }, inFirst);
+    auto inSecond = second.connect(doubled);
+    auto sink = reaction::action([&](int d) { result.store(d + 1); }, inSecond);
+    EXPECT_EQ(result.load(), 1);
+
+    auto &graph = reaction::ObserverGraph::getInstance();
+    auto epoch = graph.epoch();
+    first.start();
+    second.start();
+    for (int i = 1; i <= 1000; ++i) {
+        tick.value(i);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (result.load() != 2001 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    first.stop();
+    second.stop();
+    EXPECT_EQ(result.load(), 2001);
+    EXPECT_EQ(inSecond.get(), 2000);
+    EXPECT_EQ(graph.epoch(), epoch + 1000); // 只有写线程的1000轮提交epoch
+}
+
+TEST(ReactionTest, TestGraphBuilder) {
+    auto &graph = reaction::ObserverGraph::getInstance();
+    auto base = graph.size();
+    int count = 0;
+    reaction::GraphBuilder builder(1001);
+    auto src = builder.var(1);
+    std::vector<reaction::React<reaction::ReactImpl<std::function<int(int)>, decltype(src)>>> layer;
+    for (int i = 0; i < 1000; ++i) {
+        layer.push_back(builder.calc(std::function<int(int)>([&count, i](int s) { ++count; return s + i; }), src));
+    }
+    auto total = builder.calc([&count](int first, int last) { ++count; return first + last; }, layer.front(), layer.back());
+    EXPECT_EQ(count, 0); // 提交前不求值
+    EXPECT_EQ(builder.pending(), 1001u);
+    builder.commit();
+    EXPECT_EQ(count, 1001);
+    EXPECT_EQ(total.get(), 1 + 1000);
+    EXPECT_EQ(graph.size(), base + 1002);
+
+    count = 0;
+    src.value(2);
+    EXPECT_EQ(count, 1001);
+    EXPECT_EQ(total.get(), 2 + 1001);
+}
+
+TEST(ReactionTest, TestGraphBuilderRollback) {
+    auto &graph = reaction::ObserverGraph::getInstance();
+    auto src = reaction::var(1);
+    auto base = graph.size();
+    reaction::GraphBuilder builder;
+    auto ok = builder.calc([](int s) { return s; }, src);
+    auto bad = builder.calc([](int s) -> int { throw std::runtime_error("bad " + std::to_string(s)); }, ok);
+    EXPECT_THROW(builder.commit(), std::runtime_error);
+    EXPECT_EQ(graph.size(), base);
+    EXPECT_FALSE(static_cast<bool>(bad));
+    src.value(2); // 撤销后的结点已从源结点摘除
+}
+
+TEST(ReactionTest, TestExpectedPropagation) {
+    auto a = reaction::var(10);
+    auto b = reaction::var(0);
+    int called = 0;
+    auto q = reaction::tryCalc([](int x, int y) {
+        if (y == 0) throw std::runtime_error("division by zero");
+        return x / y;
+    },
+        a, b);
+    auto r = reaction::tryCalc([&called](int v) { ++called; return v + 1; }, q);
+    auto checked = reaction::tryCalc([](int v) -> reaction::Expected<int> {
+        if (v < 0) return reaction::Error{"negative"};
+        return v;
+    },
+        a);
+    auto fallback = reaction::calc([](const reaction::Expected<int> &e) { return e.valueOr(-1); }, r);
+
+    EXPECT_FALSE(q.get().hasValue());
+    EXPECT_EQ(q.get().error().message, "division by zero");
+    EXPECT_EQ(r.get().error().message, "division by zero"); // 错误作为值传播, 不调用下游函数
+    EXPECT_EQ(called, 0);
+    EXPECT_EQ(fallback.get(), -1);
+    EXPECT_EQ(checked.get().value(), 10);
+
+    b.value(2);
+    EXPECT_EQ(q.get().value(), 5);
+    EXPECT_EQ(r.get().value(), 6);
+    EXPECT_EQ(called, 1);
+    EXPECT_EQ(fallback.get(), 6);
+
+    a.value(-4);
+    EXPECT_EQ(checked.get().error().message, "negative");
+    EXPECT_EQ(r.get().value(), -1);
+
+    ASSERT_NE(a.tryGet(), nullptr);
+    EXPECT_EQ(*a.tryGet(), -4);
+    decltype(a) empty;
+    EXPECT_EQ(empty.tryGet(), nullptr);
+}
+
+TEST(ReactionTest, TestGenerationalHandle) {
+    static_assert(sizeof(reaction::React<reaction::ReactImpl<int>>) == 8);
+    auto &graph = reaction::ObserverGraph::getInstance();
+    auto src = reaction::var(1);
+    auto base = graph.size();
+    {
+        auto copy = src;
+        auto moved = std::move(copy);
+        EXPECT_EQ(moved.get(), 1);
+        EXPECT_EQ(graph.size(), base);
+    }
+    EXPECT_EQ(src.get(), 1);
+
+    std::optional<reaction::React<reaction::ReactImpl<std::function<int(int)>, decltype(src)>>> stale;
+    {
+        reaction::GraphBuilder builder;
+        stale = builder.calc(std::function<int(int)>([](int v) { return v; }), src);
+        EXPECT_TRUE(static_cast<bool>(*stale));
+    } // 未提交, 结点被撤销, 槽位代数加一
+    EXPECT_FALSE(static_cast<bool>(*stale));
+    auto reuse = reaction::var(5); // 复用刚释放的槽位, 旧句柄仍然失效
+    EXPECT_FALSE(static_cast<bool>(*stale));
+    EXPECT_THROW(stale->get(), std::runtime_error);
+    EXPECT_EQ(stale->tryGet(), nullptr);
+    EXPECT_EQ(reuse.get(), 5);
+    stale.reset();
+    EXPECT_EQ(reuse.get(), 5);
+    EXPECT_EQ(graph.size(), base + 1);
+}
+
+TEST(ReactionTest, TestHandleConcurrentLookup) {
+    auto src = reaction::var(7);
+    std::atomic<bool> stop{false};
+    std::atomic<long> sum{0};
+    std::thread reader([&] { // 其他线程解引用句柄时, 构图线程继续建结点(结点表扩出新分块)
+        while (!stop.load()) {
+            sum += src.get();
+        }
+    });
+    std::vector<reaction::React<reaction::ReactImpl<int>>> nodes;
+    for (int i = 0; i < 10000; ++i) {
+        nodes.push_back(reaction::var(i));
+    }
+    nodes.clear();
+    stop = true;
+    reader.join();
+    EXPECT_EQ(sum.load() % 7, 0);
+}
+
+TEST(ReactionTest, TestPriorityClasses) {
+    auto tick = reaction::var(1);
+    std::vector<std::string> order;
+    auto report = reaction::calc([&](int t) { order.push_back("report"); return t; }, tick);
+    auto summary = reaction::calc([&](int r) { order.push_back("summary"); return r; }, report);
+    auto signal = reaction::calc([&](int t) { order.push_back("signal"); return t * 2; }, tick);
+    auto send = reaction::action([&](int) { order.push_back("send"); }, signal);
+    auto audit = reaction::calc([&](int t) { order.push_back("audit"); return t; }, tick);
+    auto archive = reaction::calc([&](int t) { order.push_back("archive"); return t; }, tick);
+    send.setPriority(reaction::Priority::Critical);
+    audit.setPriority(reaction::Priority::Low);
+    archive.setPriority(reaction::Priority::Idle);
+    EXPECT_EQ(signal.getPtr()->effectivePriority(), reaction::Priority::Critical); // 继承下游的优先级
+    EXPECT_EQ(tick.getPtr()->effectivePriority(), reaction::Priority::Critical);
+
+    order.clear();
+    tick.value(2);
+    EXPECT_EQ(order, (std::vector<std::string>{"signal", "send", "report", "summary", "audit"}));
+    EXPECT_EQ(archive.get(), 1); // Idle结点推迟到runIdle
+    EXPECT_TRUE(reaction::Scheduler::getInstance().hasIdleWork());
+
+    tick.value(3);
+    EXPECT_TRUE(reaction::runIdle());
+    EXPECT_EQ(archive.get(), 3);
+    EXPECT_EQ(std::ranges::count(order, "archive"), 1); // 积压期间多次触发只求值一次
+    EXPECT_FALSE(reaction::runIdle());
+
+    send.setPriority(reaction::Priority::Normal);
+    EXPECT_EQ(signal.getPtr()->effectivePriority(), reaction::Priority::Normal);
+}
+
+TEST(ReactionTest, TestIdlePromotion) {
+    auto tick = reaction::var(1);
+    auto scaled = reaction::calc([](int t) { return t * 10; }, tick);
+    scaled.setPriority(reaction::Priority::Idle);
+    tick.value(2);
+    EXPECT_EQ(scaled.get(), 10);
+    scaled.setPriority(reaction::Priority::Normal); // 积压的结点立即补上错过的求值
+    EXPECT_EQ(scaled.get(), 20);
+    EXPECT_FALSE(reaction::Scheduler::getInstance().hasIdleWork());
+    tick.value(3);
+    tick.value(4);
+    EXPECT_EQ(scaled.get(), 40);
+}
+
+TEST(ReactionTest, TestEventLoopInput) {
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK), 0);
+    int counter = ::eventfd(0, EFD_NONBLOCK);
+    ASSERT_GE(counter, 0);
+
+    auto price = reaction::var(0);
+    auto ticks = reaction::var(uint64_t{0});
+    int count = 0;
+    auto view = reaction::calc([&](int p, uint64_t t) { ++count; return p * 1000 + static_cast<int>(t); }, price, ticks);
+
+    reaction::EventLoop loop;
+    loop.bind(fds[0], price, reaction::rawDecoder<int>());
+    loop.bind(counter, ticks, reaction::rawDecoder<uint64_t>());
+    EXPECT_EQ(loop.runOnce(0), 0u);
+
+    count = 0;
+    for (int p : {1, 2, 3}) {
+        ASSERT_EQ(::write(fds[1], &p, sizeof(p)), static_cast<ssize_t>(sizeof(p)));
+    }
+    uint64_t inc = 5;
+    ASSERT_EQ(::write(counter, &inc, sizeof(inc)), static_cast<ssize_t>(sizeof(inc)));
+    EXPECT_EQ(loop.runOnce(100), 4u);
+    EXPECT_EQ(count, 1); // 一次唤醒的所有输入合并为一轮传播
+    EXPECT_EQ(view.get(), 3005);
+
+    ::close(fds[1]); // 对端关闭后自动解绑
+    loop.runOnce(100);
+    EXPECT_EQ(loop.size(), 1u);
+
+    std::thread stopper([&loop] { loop.stop(); });
+    loop.run();
+    stopper.join();
+    ::close(fds[0]);
+    ::close(counter);
+}
+
+TEST(ReactionTest, TestEventLoopHangupDrain) {
+    int fds[2];
+    ASSERT_EQ(::pipe2(fds, O_NONBLOCK), 0);
+    auto price = reaction::var(0);
+    int sum = 0;
+    auto total = reaction::action([&](int p) { sum += p; }, price);
+
+    reaction::EventLoop loop;
+    loop.bind(fds[0], price, reaction::rawDecoder<int>());
+    for (int p = 1; p <= 100; ++p) {
+        ASSERT_EQ(::write(fds[1], &p, sizeof(p)), static_cast<ssize_t>(sizeof(p)));
+    }
+    ::close(fds[1]);
+    EXPECT_EQ(loop.runOnce(100), reaction::EventLoop::MaxBurst);
+    EXPECT_EQ(loop.size(), 1u); // 被MaxBurst截断, 剩余数据还没读完, 不能解绑
+    EXPECT_EQ(loop.runOnce(100), 100u - reaction::EventLoop::MaxBurst);
+    EXPECT_EQ(loop.size(), 0u);
+    EXPECT_EQ(price.get(), 100);
+    EXPECT_EQ(sum, 64 + 100); // 每次唤醒合并为一轮, 下游只看到每轮最后一个值
+    ::close(fds[0]);
+}
+
+TEST(ReactionTest, TestMemoryAccounting) {
+    using reaction::NodeKind;
+    auto before = reaction::memoryReport();
+    auto a = reaction::var(1);
+    auto b = reaction::var(std::string("x"));
+    auto c = reaction::calc([](int x, const std::string &s) { return s + std::to_string(x); }, a, b);
+    auto d = reaction::action([](const std::string &) {}, c);
+    auto e = reaction::expr(a + a);
+    auto after = reaction::memoryReport();
+    EXPECT_EQ(after[NodeKind::Var].nodes - before[NodeKind::Var].nodes, 2u);
+    EXPECT_EQ(after[NodeKind::Calc].nodes - before[NodeKind::Calc].nodes, 1u);
+    EXPECT_EQ(after[NodeKind::Action].nodes - before[NodeKind::Action].nodes, 1u);
+    EXPECT_EQ(after[NodeKind::Expr].nodes - before[NodeKind::Expr].nodes, 1u);
+    EXPECT_GT(after[NodeKind::Calc].bytes, before[NodeKind::Calc].bytes);
+    EXPECT_GT(after.total().allocations, before.total().allocations);
+
+    std::vector<reaction::Versioned<int>> mirrors; // 镜像结点只由NodePtr持有, 不在结点表中
+    for (int i = 0; i < 100; ++i) {
+        mirrors.emplace_back(a);
+    }
+    EXPECT_EQ(reaction::memoryReport()[NodeKind::Action].nodes - after[NodeKind::Action].nodes, 100u);
+}
+
+TEST(ReactionTest, TestGatedPropagation) {
+    auto price = reaction::var(100);
+    auto open = reaction::var(false);
+    int count = 0;
+
+    auto large = reaction::filter([](int p) { return p >= 200; }, price);
+    auto largeSink = reaction::calc([&](int p) { ++count; return p; }, large);
+    auto session = reaction::when(open, price);
+    auto sessionSink = reaction::calc([&](int p) { ++count; return p * 2; }, session);
+    auto level = reaction::calc([](int p) { return p / 100; }, price);
+    auto distinct = reaction::distinctUntilChanged(level);
+    auto levelSink = reaction::calc([&](int l) { ++count; return l; }, distinct);
+
+    count = 0;
+    price.value(150); // 所有门都关着, 下游子图一个都不求值
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(large.get(), 0);
+
+    price.value(250);
+    EXPECT_EQ(largeSink.get(), 250);
+    EXPECT_EQ(levelSink.get(), 2);
+    EXPECT_EQ(count, 2);
+
+    count = 0;
+    price.value(260);
+    EXPECT_EQ(count, 1); // 只有filter放行, level未变化
+    open.value(true); // 打开时立即转发当前值
+    EXPECT_EQ(sessionSink.get(), 520);
+    EXPECT_EQ(count, 2);
+
+    count = 0;
+    open.value(false);
+    EXPECT_EQ(count, 0);
+    EXPECT_EQ(sessionSink.get(), 520);
+}
+
 // struct ProcessedData {
 //     std::string info;
 //     int checksum;